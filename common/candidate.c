@@ -0,0 +1,201 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Rendering of compact pairalign results, see include/candidate.h
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "candidate.h"
+
+/*
+  Indices of the core stem, as in pairalign/cpairalign.c:
+
+  BRACKET  = ...(......[....)......].....
+  NOTATION = ...L......R....l......r.....
+
+  Loop stems extend outwards from the core stem. A bulge is placed after the
+  loop stems, leaving size_left and size_right unpaired positions on each side.
+*/
+void candidate_render(const struct candidate *c, char *dot_bracket, int len) {
+  int L = c->i;
+  int R = c->i + c->left_loop_size + 1;
+  int l = c->i + c->left_loop_size + c->dd_size + 2;
+  int r = c->i + c->j - 1;
+
+  memset(dot_bracket, '.', len);
+
+  memset(&dot_bracket[L - c->left_stems], '(', c->left_stems + 1);
+  memset(&dot_bracket[l], ')', c->left_stems + 1);
+  memset(&dot_bracket[R - c->right_stems], '[', c->right_stems + 1);
+  memset(&dot_bracket[r], ']', c->right_stems + 1);
+
+  const struct candidate_bulge *lb = &c->left_bulge, *rb = &c->right_bulge;
+  if (lb->stems > 0) {
+    memset(&dot_bracket[L - c->left_stems - lb->size_left - lb->stems], '(',
+           lb->stems);
+    memset(&dot_bracket[l + c->left_stems + 1 + lb->size_right], ')',
+           lb->stems);
+  }
+  if (rb->stems > 0) {
+    memset(&dot_bracket[R - c->right_stems - rb->size_left - rb->stems], '[',
+           rb->stems);
+    memset(&dot_bracket[r + c->right_stems + 1 + rb->size_right], ']',
+           rb->stems);
+  }
+}
+
+/*
+  The final pair of a loop is the outermost pair of its bulge if there is one,
+  otherwise the outermost loop stem. Returns false if the loop has no stems
+  other than the core stem.
+*/
+static bool final_pair(int core_left, int core_right, int stems,
+                       const struct candidate_bulge *bulge, int *a, int *b) {
+  if (bulge->stems > 0) {
+    *a = core_left - stems - bulge->size_left - bulge->stems;
+    *b = core_right + stems + bulge->size_right + bulge->stems;
+    return true;
+  }
+  *a = core_left - stems;
+  *b = core_right + stems;
+  return stems > 0;
+}
+
+// remove the final pair of a loop, see final_pair()
+static void skip_final_pair(int32_t *stems, struct candidate_bulge *bulge) {
+  if (bulge->stems > 0) {
+    if (--bulge->stems == 0) {
+      *bulge = (struct candidate_bulge){0};
+    }
+  } else {
+    (*stems)--;
+  }
+}
+
+void candidate_emit(const struct candidate *c, const struct packed_sequence *ps,
+                    bool skip_final_au, candidate_emit_fn emit, void *data) {
+  emit(c, data);
+  if (!skip_final_au) {
+    return;
+  }
+
+  int L = c->i;
+  int R = c->i + c->left_loop_size + 1;
+  int l = c->i + c->left_loop_size + c->dd_size + 2;
+  int r = c->i + c->j - 1;
+  int a, b;
+
+  bool left_is_au =
+      c->left_loop_stems > 0 &&
+      final_pair(L, l, c->left_stems, &c->left_bulge, &a, &b) &&
+      packed_sequence_is_au(ps, a, b);
+  bool right_is_au =
+      c->right_loop_stems > 0 &&
+      final_pair(R, r, c->right_stems, &c->right_bulge, &a, &b) &&
+      packed_sequence_is_au(ps, a, b);
+
+  struct candidate v;
+  if (left_is_au) {
+    v = *c;
+    skip_final_pair(&v.left_stems, &v.left_bulge);
+    v.left_loop_stems--;
+    v.skipped_au = CANDIDATE_SKIPPED_AU_LEFT;
+    emit(&v, data);
+  }
+  if (right_is_au) {
+    v = *c;
+    skip_final_pair(&v.right_stems, &v.right_bulge);
+    v.right_loop_stems--;
+    v.skipped_au = CANDIDATE_SKIPPED_AU_RIGHT;
+    emit(&v, data);
+  }
+  if (left_is_au && right_is_au) {
+    skip_final_pair(&v.left_stems, &v.left_bulge);
+    v.left_loop_stems--;
+    v.skipped_au |= CANDIDATE_SKIPPED_AU_LEFT;
+    emit(&v, data);
+  }
+}
+
+void candidate_callback(const struct candidate *c, void *data) {
+  struct candidate_callback *cc = (struct candidate_callback *)data;
+  candidate_render(c, cc->dot_bracket, cc->len);
+  cc->cb(cc->dot_bracket, c->left_loop_stems, c->right_loop_stems);
+}
+
+char *render_candidates(int32_t *candidates, int n, int len) {
+  char *out = malloc((size_t)n * len + 1);
+  for (int k = 0; k < n; k++) {
+    candidate_render((struct candidate *)(candidates + k * CANDIDATE_WIDTH),
+                     out + (size_t)k * len, len);
+  }
+  return out;
+}
+
+// the fields of a candidate that determine its dot bracket, see
+// candidate_render()
+#define KEY_OFFSET offsetof(struct candidate, i)
+#define KEY_SIZE (offsetof(struct candidate, skipped_au) - KEY_OFFSET)
+
+static const char *candidate_key(const int32_t *candidates, int k) {
+  return (const char *)(candidates + (size_t)k * CANDIDATE_WIDTH) + KEY_OFFSET;
+}
+
+// FNV-1a over the key of a candidate
+static uint32_t candidate_hash(const char *key) {
+  uint32_t h = 2166136261u;
+  for (size_t b = 0; b < KEY_SIZE; b++) {
+    h = (h ^ (unsigned char)key[b]) * 16777619u;
+  }
+  return h;
+}
+
+int dedup_candidates(int32_t *candidates, int n, int32_t *first) {
+  // open addressing with linear probing, at most half full
+  size_t capacity = 16;
+  while (capacity < 2 * (size_t)n) {
+    capacity *= 2;
+  }
+  int32_t *slots = malloc(capacity * sizeof(int32_t));
+  memset(slots, -1, capacity * sizeof(int32_t));
+
+  int unique = 0;
+  for (int k = 0; k < n; k++) {
+    const char *key = candidate_key(candidates, k);
+    size_t slot = candidate_hash(key) & (capacity - 1);
+    while (slots[slot] != -1 &&
+           memcmp(candidate_key(candidates, slots[slot]), key, KEY_SIZE)) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+    if (slots[slot] == -1) {
+      slots[slot] = k;
+      unique++;
+    }
+    first[k] = slots[slot];
+  }
+
+  free(slots);
+  return unique;
+}
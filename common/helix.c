@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Helix run length tables, see include/helix.h
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "helix.h"
+
+void helix_table_init(struct helix_table *ht, const struct packed_sequence *ps,
+                      const struct pair_table *pairs) {
+  int n = ps->len;
+
+  ht->len = n;
+  ht->run = (int16_t *)calloc((size_t)n * n + 1, sizeof(int16_t));
+
+  // run(a, b) extends run(a - 1, b + 1), which is computed first
+  for (int a = 0; a < n; a++) {
+    int16_t *row = ht->run + (size_t)a * n;
+    const int16_t *prev = a > 0 ? row - n : NULL;
+    for (int b = a + 1; b < n; b++) {
+      if (packed_sequence_pairs(ps, pairs, a, b)) {
+        row[b] = 1 + (prev != NULL && b < n - 1 ? prev[b + 1] : 0);
+      }
+    }
+  }
+}
+
+void helix_table_free(struct helix_table *ht) {
+  free(ht->run);
+  ht->run = NULL;
+}
+
+struct helix_context *helix_context_new(const char *sequence,
+                                        const struct pair_table *pairs) {
+  struct helix_context *ctx = malloc(sizeof(struct helix_context));
+  ctx->sequence = strdup(sequence);
+  packed_sequence_init(&ctx->ps, sequence);
+  helix_table_init(&ctx->helices, &ctx->ps, pairs);
+  return ctx;
+}
+
+void helix_context_free(struct helix_context *ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  helix_table_free(&ctx->helices);
+  packed_sequence_free(&ctx->ps);
+  free(ctx->sequence);
+  free(ctx);
+}
+
+// last sequence prepared by helix_context_get() in this thread
+static __thread struct helix_context *t_cached;
+static __thread const struct pair_table *t_cached_pairs;
+
+const struct helix_context *helix_context_get(const char *sequence,
+                                              const struct pair_table *pairs) {
+  if (t_cached != NULL && t_cached_pairs == pairs &&
+      strcmp(t_cached->sequence, sequence) == 0) {
+    return t_cached;
+  }
+
+  helix_context_free(t_cached);
+  t_cached = helix_context_new(sequence, pairs);
+  t_cached_pairs = pairs;
+  return t_cached;
+}
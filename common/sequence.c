@@ -0,0 +1,139 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Shared nucleotide encoding for the C libraries, see
+// include/sequence.h
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sequence.h"
+
+static const struct pair_table s_pairs_canonical = {{
+    // A  C  G  U
+    {0, 0, 0, 1}, // A
+    {0, 0, 1, 0}, // C
+    {0, 1, 0, 0}, // G
+    {1, 0, 0, 0}, // U
+}};
+
+static const struct pair_table s_pairs_wobble = {{
+    // A  C  G  U
+    {0, 0, 0, 1}, // A
+    {0, 0, 1, 0}, // C
+    {0, 1, 0, 1}, // G
+    {1, 0, 1, 0}, // U
+}};
+
+const struct pair_table *pair_table_get(int allow_ug) {
+  return allow_ug ? &s_pairs_wobble : &s_pairs_canonical;
+}
+
+static int encode(char c) {
+  switch (c) {
+  case 'a':
+  case 'A':
+    return NUC_A;
+  case 'c':
+  case 'C':
+    return NUC_C;
+  case 'g':
+  case 'G':
+    return NUC_G;
+  case 'u':
+  case 'U':
+    return NUC_U;
+  default:
+    return -1;
+  }
+}
+
+int packed_sequence_init(struct packed_sequence *ps, const char *sequence) {
+  int len = strlen(sequence);
+  int words = BITSET_WORDS(len);
+  int packed_words = (len + 31) / 32;
+
+  // a single allocation for the packed sequence and all bitsets
+  uint64_t *data = calloc(packed_words + 5 * words + 1, sizeof(uint64_t));
+  ps->len = len;
+  ps->words = words;
+  ps->packed = data;
+  ps->valid = data + packed_words;
+  for (int n = 0; n < 4; n++) {
+    ps->masks[n] = ps->valid + (n + 1) * words;
+  }
+
+  int invalid = 0;
+  for (int i = 0; i < len; i++) {
+    int n = encode(sequence[i]);
+    if (n < 0) {
+      invalid++;
+      continue;
+    }
+    ps->packed[i >> 5] |= (uint64_t)n << ((i & 31) << 1);
+    bitset_set(ps->valid, i);
+    bitset_set(ps->masks[n], i);
+  }
+
+  return invalid;
+}
+
+void packed_sequence_free(struct packed_sequence *ps) {
+  free(ps->packed);
+  ps->packed = NULL;
+}
+
+// last sequence encoded by packed_sequence_get() in this thread
+static __thread struct packed_sequence t_cached;
+static __thread char *t_cached_text;
+static __thread size_t t_cached_capacity;
+
+const struct packed_sequence *packed_sequence_get(const char *sequence) {
+  size_t len = strlen(sequence);
+  if (t_cached_text != NULL && t_cached.len == (int)len &&
+      memcmp(t_cached_text, sequence, len) == 0) {
+    return &t_cached;
+  }
+
+  if (t_cached_text != NULL) {
+    packed_sequence_free(&t_cached);
+  }
+  if (len + 1 > t_cached_capacity) {
+    t_cached_capacity = len + 1;
+    t_cached_text = realloc(t_cached_text, t_cached_capacity);
+  }
+  memcpy(t_cached_text, sequence, len + 1);
+  packed_sequence_init(&t_cached, sequence);
+  return &t_cached;
+}
+
+void packed_sequence_partners(const struct packed_sequence *ps,
+                              const struct pair_table *pairs,
+                              enum nucleotide n, uint64_t *out) {
+  bitset_clear(out, ps->words);
+  for (int m = 0; m < 4; m++) {
+    if (pairs->pairs[n][m]) {
+      bitset_or(out, ps->masks[m], ps->words);
+    }
+  }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Bump allocator for short-lived allocations, e.g. YAEP parse
+// trees and the lists built while traversing them. Memory is only released
+// all at once, with arena_reset() or arena_free().
+
+#ifndef KNOTIFY_ARENA_H
+#define KNOTIFY_ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_MIN_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN_UP(x)                                                      \
+  (((x) + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1))
+
+struct arena_block {
+  struct arena_block *next;
+  size_t size;
+  size_t used;
+};
+
+struct arena {
+  struct arena_block *head; // block that is currently allocated from
+};
+
+#define ARENA_BLOCK_DATA(b)                                                    \
+  ((char *)(b) + ARENA_ALIGN_UP(sizeof(struct arena_block)))
+
+static inline struct arena_block *arena_new_block(size_t size,
+                                                  struct arena_block *next) {
+  struct arena_block *b = (struct arena_block *)malloc(
+      ARENA_ALIGN_UP(sizeof(struct arena_block)) + size);
+  if (b == NULL) {
+    abort();
+  }
+  b->next = next;
+  b->size = size;
+  b->used = 0;
+  return b;
+}
+
+static inline void *arena_alloc(struct arena *a, size_t size) {
+  size = ARENA_ALIGN_UP(size);
+
+  struct arena_block *b = a->head;
+  if (b == NULL || b->used + size > b->size) {
+    size_t block_size = b ? 2 * b->size : ARENA_MIN_BLOCK_SIZE;
+    while (block_size < size) {
+      block_size *= 2;
+    }
+    b = a->head = arena_new_block(block_size, b);
+  }
+
+  void *p = ARENA_BLOCK_DATA(b) + b->used;
+  b->used += size;
+  return p;
+}
+
+/**
+ * Release all allocations. If the last round needed more than one block,
+ * they are merged into a single block that is large enough, so that the
+ * arena stops calling malloc once it has grown to the working set size.
+ **/
+static inline void arena_reset(struct arena *a) {
+  struct arena_block *b = a->head;
+  if (b == NULL) {
+    return;
+  }
+
+  if (b->next != NULL) {
+    size_t total = 0;
+    while (b != NULL) {
+      struct arena_block *next = b->next;
+      total += b->size;
+      free(b);
+      b = next;
+    }
+    b = a->head = arena_new_block(total, NULL);
+  }
+
+  b->used = 0;
+}
+
+static inline void arena_free(struct arena *a) {
+  struct arena_block *b = a->head;
+  while (b != NULL) {
+    struct arena_block *next = b->next;
+    free(b);
+    b = next;
+  }
+  a->head = NULL;
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Fixed-size bitsets stored as arrays of 64-bit words. The size
+// of each bitset is managed by the caller.
+
+#ifndef KNOTIFY_BITSET_H
+#define KNOTIFY_BITSET_H
+
+#include <stdint.h>
+#include <string.h>
+
+// number of words needed to store n bits
+#define BITSET_WORDS(n) (((n) + 63) / 64)
+
+static inline void bitset_clear(uint64_t *b, int words) {
+  memset(b, 0, words * sizeof(uint64_t));
+}
+
+static inline void bitset_set(uint64_t *b, int i) {
+  b[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline int bitset_test(const uint64_t *b, int i) {
+  return (b[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline int bitset_empty(const uint64_t *b, int words) {
+  for (int w = 0; w < words; w++) {
+    if (b[w]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// dst |= src
+static inline void bitset_or(uint64_t *dst, const uint64_t *src, int words) {
+  for (int w = 0; w < words; w++) {
+    dst[w] |= src[w];
+  }
+}
+
+// dst |= src << shift. Bits shifted past the last word are dropped.
+static inline void bitset_or_shifted(uint64_t *dst, const uint64_t *src,
+                                     int words, int shift) {
+  int ws = shift >> 6, bs = shift & 63;
+  for (int w = words - 1; w >= ws; w--) {
+    uint64_t v = src[w - ws] << bs;
+    if (bs && w - ws - 1 >= 0) {
+      v |= src[w - ws - 1] >> (64 - bs);
+    }
+    dst[w] |= v;
+  }
+}
+
+// index of the first set bit at position >= i, or -1 if there is none
+static inline int bitset_next(const uint64_t *b, int words, int i) {
+  int w = i >> 6;
+  if (w >= words) {
+    return -1;
+  }
+  uint64_t v = b[w] & (~(uint64_t)0 << (i & 63));
+  while (!v) {
+    if (++w >= words) {
+      return -1;
+    }
+    v = b[w];
+  }
+  return (w << 6) + __builtin_ctzll(v);
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Compact pairalign results. A candidate holds the core stem, the
+// loop stems and the bulges of a pseudoknot as a fixed-size struct of int32
+// values, so that the dot bracket only needs to be rendered for the
+// candidates that are actually used. Implemented in common/candidate.c.
+
+#ifndef KNOTIFY_CANDIDATE_H
+#define KNOTIFY_CANDIDATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "packed.h"
+#include "sequence.h"
+
+/**
+ * Bulge before the loop stems, see find_bulge() in pairalign/bulges.c.
+ * size_left and size_right are the unpaired positions on each side, and
+ * stems == 0 means there is no bulge.
+ **/
+struct candidate_bulge {
+  int32_t size_left;
+  int32_t size_right;
+  int32_t stems;
+};
+
+struct candidate {
+  // row index of the core stem in the pairalign input
+  int32_t core_stem;
+
+  // loop stems, as reported to the caller of pairalign
+  int32_t left_loop_stems;
+  int32_t right_loop_stems;
+
+  // core stem, as returned by the parsers
+  int32_t i;
+  int32_t j;
+  int32_t left_loop_size;
+  int32_t dd_size;
+
+  // consecutive loop stems next to the core stem of each loop
+  int32_t left_stems;
+  int32_t right_stems;
+
+  struct candidate_bulge left_bulge;
+  struct candidate_bulge right_bulge;
+
+  // loops whose final AU pair was skipped, see candidate_emit()
+  int32_t skipped_au;
+};
+
+#define CANDIDATE_SKIPPED_AU_LEFT 1
+#define CANDIDATE_SKIPPED_AU_RIGHT 2
+
+#define CANDIDATE_WIDTH ((int)(sizeof(struct candidate) / sizeof(int32_t)))
+
+// append a candidate to a packed_rows buffer of width CANDIDATE_WIDTH
+static inline void candidate_push(struct packed_rows *rows,
+                                  const struct candidate *c) {
+  memcpy(packed_rows_push(rows), c, sizeof(struct candidate));
+}
+
+typedef void (*candidate_emit_fn)(const struct candidate *, void *);
+
+/**
+ * Pass a candidate to emit. With skip_final_au, also pass the variants of the
+ * candidate without the final (outermost) pair of the left loop, the right
+ * loop, and both loops, for each loop where that pair is an AU pair. These are
+ * the same results as skip_final_au() in pairalign/skipfinalau.c, without
+ * looking for the stems in the dot bracket.
+ **/
+void candidate_emit(const struct candidate *c, const struct packed_sequence *ps,
+                    bool skip_final_au, candidate_emit_fn emit, void *data);
+
+/**
+ * Write the dot bracket of a candidate to dot_bracket, len characters without
+ * a terminator.
+ **/
+void candidate_render(const struct candidate *c, char *dot_bracket, int len);
+
+/**
+ * Adapter for the pairalign() callback: renders each candidate into the
+ * dot_bracket buffer (len + 1 bytes) and passes it to cb.
+ **/
+struct candidate_callback {
+  void (*cb)(char *, int, int);
+  char *dot_bracket;
+  int len;
+};
+
+void candidate_callback(const struct candidate *c, void *data);
+
+/**
+ * Render the dot brackets of n candidates, len characters per candidate
+ * without any terminators. candidates holds n rows of CANDIDATE_WIDTH values,
+ * as returned by pairalign_candidates(). Release with packed_free().
+ **/
+char *render_candidates(int32_t *candidates, int n, int len);
+
+/**
+ * Find candidates with the same dot bracket. Candidates are compared with a
+ * hash set of their core stem coordinates, loop stems and bulges, which
+ * determine the dot bracket (reported stem counts and the core stem row are
+ * ignored).
+ *
+ * Sets first[k] to the index of the first candidate with the same dot bracket
+ * as candidate k, and returns the number of distinct dot brackets.
+ **/
+int dedup_candidates(int32_t *candidates, int n, int32_t *first);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Per-sequence table of helix run lengths. run(a, b) is the
+// number of consecutive pairs (a, b), (a-1, b+1), (a-2, b+2), ... along the
+// anti-diagonal through (a, b), so extending a stem outwards from any pair is
+// a single lookup. Implemented in common/helix.c.
+
+#ifndef KNOTIFY_HELIX_H
+#define KNOTIFY_HELIX_H
+
+#include <stdint.h>
+
+#include "sequence.h"
+
+struct helix_table {
+  int len;
+  int16_t *run; // run[a * len + b], for a < b
+};
+
+/**
+ * A sequence prepared for pairalign: its encoding and helix table, along with
+ * a copy of the sequence itself.
+ **/
+struct helix_context {
+  char *sequence;
+  struct packed_sequence ps;
+  struct helix_table helices;
+};
+
+/**
+ * Build the helix table of an encoded sequence in O(len^2) time and memory.
+ * Release with helix_table_free().
+ **/
+void helix_table_init(struct helix_table *ht, const struct packed_sequence *ps,
+                      const struct pair_table *pairs);
+void helix_table_free(struct helix_table *ht);
+
+/**
+ * Prepare a sequence. Release with helix_context_free().
+ **/
+struct helix_context *helix_context_new(const char *sequence,
+                                        const struct pair_table *pairs);
+void helix_context_free(struct helix_context *ctx);
+
+/**
+ * Returns the prepared sequence, reusing the last prepared sequence of the
+ * calling thread if it is the same. The result is owned by the cache, and is
+ * valid until the next call from the same thread.
+ **/
+const struct helix_context *helix_context_get(const char *sequence,
+                                              const struct pair_table *pairs);
+
+static inline int helix_min(int a, int b) { return a < b ? a : b; }
+
+/**
+ * Number of consecutive pairs (a, b), (a-1, b+1), ... with all left positions
+ * >= a_min and all right positions <= b_max.
+ **/
+static inline int helix_table_stems(const struct helix_table *ht, int a, int b,
+                                    int a_min, int b_max) {
+  if (a < a_min || b > b_max || a >= b) {
+    return 0;
+  }
+  return helix_min(ht->run[(size_t)a * ht->len + b],
+                   helix_min(a - a_min + 1, b_max - b + 1));
+}
+
+#endif
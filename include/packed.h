@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Growable buffers for returning results to the caller without
+// a callback per result. A packed_rows buffer holds rows of `width` int32
+// values, and a packed_chars buffer holds fixed-size strings back to back.
+//
+// Ownership of the data is passed to the caller with packed_*_release(). The
+// caller is expected to release it with the packed_free() function exported
+// by the library that allocated it.
+
+#ifndef KNOTIFY_PACKED_H
+#define KNOTIFY_PACKED_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKED_MIN_CAPACITY 256
+
+struct packed_rows {
+  int32_t *data;
+  int width;
+  size_t count, capacity; // in rows
+};
+
+struct packed_chars {
+  char *data;
+  size_t size, capacity; // in bytes
+};
+
+static inline void packed_rows_init(struct packed_rows *b, int width) {
+  b->data = NULL;
+  b->width = width;
+  b->count = 0;
+  b->capacity = 0;
+}
+
+// append a row and return a pointer to it, the caller fills in the values
+static inline int32_t *packed_rows_push(struct packed_rows *b) {
+  if (b->count == b->capacity) {
+    b->capacity = b->capacity ? 2 * b->capacity : PACKED_MIN_CAPACITY;
+    b->data = (int32_t *)realloc(b->data,
+                                 b->capacity * b->width * sizeof(int32_t));
+    if (b->data == NULL) {
+      abort();
+    }
+  }
+  return b->data + b->width * b->count++;
+}
+
+static inline int32_t *packed_rows_release(struct packed_rows *b,
+                                           int32_t *count) {
+  int32_t *data = b->data;
+  *count = b->count;
+  packed_rows_init(b, b->width);
+  return data;
+}
+
+static inline void packed_chars_init(struct packed_chars *b) {
+  b->data = NULL;
+  b->size = 0;
+  b->capacity = 0;
+}
+
+static inline void packed_chars_append(struct packed_chars *b, const char *s,
+                                       size_t n) {
+  if (b->size + n > b->capacity) {
+    b->capacity = b->capacity ? 2 * b->capacity : PACKED_MIN_CAPACITY;
+    while (b->capacity < b->size + n) {
+      b->capacity *= 2;
+    }
+    b->data = (char *)realloc(b->data, b->capacity);
+    if (b->data == NULL) {
+      abort();
+    }
+  }
+  memcpy(b->data + b->size, s, n);
+  b->size += n;
+}
+
+static inline char *packed_chars_release(struct packed_chars *b) {
+  char *data = b->data;
+  packed_chars_init(b);
+  return data;
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Shared nucleotide encoding for the C libraries. Sequences are
+// encoded once into a packed_sequence, with 2 bits per nucleotide and one
+// bitset per nucleotide. Pairing rules are looked up in a 4x4 pair_table
+// instead of comparing characters. Implemented in common/sequence.c.
+//
+// Nucleotide codes use the same order as nuc_to_int() in simfold, so that
+// encoded sequences can be shared with the energy models.
+
+#ifndef KNOTIFY_SEQUENCE_H
+#define KNOTIFY_SEQUENCE_H
+
+#include <stdint.h>
+
+#include "bitset.h"
+
+enum nucleotide { NUC_A = 0, NUC_C = 1, NUC_G = 2, NUC_U = 3 };
+
+/**
+ * pairs[a][b] is 1 if nucleotides a and b can pair.
+ **/
+struct pair_table {
+  uint8_t pairs[4][4];
+};
+
+/**
+ * An encoded sequence. Positions with characters other than a, c, g, u (in
+ * either case) are not valid, and do not pair with anything.
+ **/
+struct packed_sequence {
+  int len;
+  int words;          // number of words of each bitset
+  uint64_t *packed;   // 2 bits per nucleotide, 32 nucleotides per word
+  uint64_t *valid;    // bitset of valid positions
+  uint64_t *masks[4]; // bitset of positions of each nucleotide
+};
+
+/**
+ * Returns the pair table with AU and CG pairs, and GU pairs if allow_ug is
+ * set. The table is static and must not be modified.
+ **/
+const struct pair_table *pair_table_get(int allow_ug);
+
+/**
+ * Encode sequence into ps. Returns the number of invalid characters. Release
+ * with packed_sequence_free().
+ **/
+int packed_sequence_init(struct packed_sequence *ps, const char *sequence);
+void packed_sequence_free(struct packed_sequence *ps);
+
+/**
+ * Returns the encoding of sequence, reusing the last encoded sequence of the
+ * calling thread if it is the same. The result is owned by the cache, and is
+ * valid until the next call from the same thread.
+ **/
+const struct packed_sequence *packed_sequence_get(const char *sequence);
+
+/**
+ * Store the bitset of all positions that can pair with nucleotide n in out,
+ * which must have room for ps->words words. Computed a word at a time.
+ **/
+void packed_sequence_partners(const struct packed_sequence *ps,
+                              const struct pair_table *pairs,
+                              enum nucleotide n, uint64_t *out);
+
+static inline int packed_sequence_valid(const struct packed_sequence *ps,
+                                        int i) {
+  return bitset_test(ps->valid, i);
+}
+
+// nucleotide at position i, only meaningful for valid positions
+static inline enum nucleotide
+packed_sequence_at(const struct packed_sequence *ps, int i) {
+  return (enum nucleotide)((ps->packed[i >> 5] >> ((i & 31) << 1)) & 3);
+}
+
+// non-zero if positions i and j can pair
+static inline int packed_sequence_pairs(const struct packed_sequence *ps,
+                                        const struct pair_table *pairs, int i,
+                                        int j) {
+  return packed_sequence_valid(ps, i) && packed_sequence_valid(ps, j) &&
+         pairs->pairs[packed_sequence_at(ps, i)][packed_sequence_at(ps, j)];
+}
+
+// non-zero if positions i and j form an AU or UA pair
+static inline int packed_sequence_is_au(const struct packed_sequence *ps, int i,
+                                        int j) {
+  if (!packed_sequence_valid(ps, i) || !packed_sequence_valid(ps, j)) {
+    return 0;
+  }
+  enum nucleotide a = packed_sequence_at(ps, i), b = packed_sequence_at(ps, j);
+  return (a == NUC_A && b == NUC_U) || (a == NUC_U && b == NUC_A);
+}
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Upper bounds on the number of consecutive loop stems of core
+// stems, used by the parsers to skip core stems (and whole windows) that
+// would be discarded by the prune_early criterion anyway.
+//
+// Loop stems are counted the same way as in pairalign/cpairalign.c (GU pairs
+// are always allowed). For a core stem with indices L, R, l, r:
+//
+//   BRACKET  = ...(......[....)......].....
+//   NOTATION = ...L......R....l......r.....
+//
+//   left loop stems  = min(run(L-1, l+1), L, r-l-1)
+//   right loop stems = min(run(R-1, r+1), R-L-1, len-1-r)
+//
+// where run(a, b) is the number of consecutive pairs (a, b), (a-1, b+1), ...
+// The run lengths are precomputed once per sequence (see helix.h).
+//
+// With the bound enabled, a core stem is skipped if its loop stems are fewer
+// than (best - allow_smaller), where best is the maximum number of loop stems
+// of all core stems reported so far. Knotify.get_results() (with prune_early)
+// would discard it, along with any variants with fewer stems, so skipping it
+// does not change the results. Results reported by the parser must be in the
+// same order as they are processed for this to hold.
+
+#ifndef KNOTIFY_STEMBOUND_H
+#define KNOTIFY_STEMBOUND_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "helix.h"
+#include "sequence.h"
+
+struct stem_bound_stats {
+  int64_t windows;
+  int64_t windows_skipped;
+  int64_t core_stems;
+  int64_t core_stems_skipped;
+};
+
+struct stem_bound {
+  int allow_smaller;
+  int best;
+  int len;
+  struct helix_table helices;
+  int16_t *maxrun; // maxrun[a]: max run(a, b), maxrun[len + b]: max run(a, b)
+  struct stem_bound_stats *stats;
+};
+
+static inline void stem_bound_init(struct stem_bound *sb,
+                                   const struct packed_sequence *ps,
+                                   int allow_smaller,
+                                   struct stem_bound_stats *stats) {
+  int n = ps->len;
+
+  sb->allow_smaller = allow_smaller;
+  sb->best = 0;
+  sb->len = n;
+  sb->stats = stats;
+  helix_table_init(&sb->helices, ps, pair_table_get(1));
+  sb->maxrun = (int16_t *)calloc(2 * n + 1, sizeof(int16_t));
+
+  for (int a = 0; a < n; a++) {
+    for (int b = a + 1; b < n; b++) {
+      int16_t run = sb->helices.run[(size_t)a * n + b];
+      if (run > sb->maxrun[a]) {
+        sb->maxrun[a] = run;
+      }
+      if (run > sb->maxrun[n + b]) {
+        sb->maxrun[n + b] = run;
+      }
+    }
+  }
+}
+
+static inline void stem_bound_free(struct stem_bound *sb) {
+  helix_table_free(&sb->helices);
+  free(sb->maxrun);
+  sb->maxrun = NULL;
+}
+
+/**
+ * Returns non-zero if no core stem of the window [left, right] can have
+ * enough loop stems. Must be called before any core stems of the window are
+ * reported.
+ **/
+static inline int stem_bound_skip_window(struct stem_bound *sb, int left,
+                                         int right) {
+  int n = sb->len;
+  int bound = 0;
+  if (left > 0) {
+    bound += helix_min(left, sb->maxrun[left - 1]);
+  }
+  if (right < n - 1) {
+    bound += helix_min(n - 1 - right, sb->maxrun[n + right + 1]);
+  }
+
+  int skip = bound < sb->best - sb->allow_smaller;
+  sb->stats->windows++;
+  sb->stats->windows_skipped += skip;
+  return skip;
+}
+
+/**
+ * Returns non-zero if the core stem does not have enough loop stems and
+ * should not be reported. Otherwise, the core stem is counted as reported.
+ **/
+static inline int stem_bound_skip_core_stem(struct stem_bound *sb, int left,
+                                            int size, int left_loop_size,
+                                            int dd_size) {
+  int n = sb->len;
+  int L = left;
+  int R = left + left_loop_size + 1;
+  int l = left + left_loop_size + dd_size + 2;
+  int r = left + size - 1;
+
+  int stems = helix_table_stems(&sb->helices, L - 1, l + 1, 0, r - 1) +
+              helix_table_stems(&sb->helices, R - 1, r + 1, L + 1, n - 1);
+
+  int skip = stems < sb->best - sb->allow_smaller;
+  sb->stats->core_stems++;
+  sb->stats->core_stems_skipped += skip;
+  if (!skip && stems > sb->best) {
+    sb->best = stems;
+  }
+  return skip;
+}
+
+#endif
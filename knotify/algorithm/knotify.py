@@ -22,6 +22,7 @@
 #
 from typing import List
 
+import numpy as np
 import pandas as pd
 
 from knotify.algorithm.base import BaseAlgorithm
@@ -29,9 +30,8 @@ from knotify.criteria import apply_free_energy_and_stems_criterion
 from knotify.energy.base import BaseEnergy
 from knotify.energy.vienna import ViennaEnergy
 from knotify import hairpin
-from knotify.pairalign.base import BasePairAlign
+from knotify.pairalign.base import BasePairAlign, CANDIDATE
 from knotify.parsers.base import BaseParser
-from knotify.extensions.skip_final_au import SkipFinalAU
 
 
 class Knotify(BaseAlgorithm):
@@ -39,7 +39,7 @@ class Knotify(BaseAlgorithm):
         self,
         sequence: str,
         parser: BaseParser,
-        skip_final_au: SkipFinalAU = None,
+        skip_final_au=None,
         pairalign: List[BasePairAlign] = [],
         csv: str = None,
         allow_skip_final_au: bool = None,
@@ -52,72 +52,136 @@ class Knotify(BaseAlgorithm):
         max_hairpins_per_loop: int = hairpin.MAX_HAIRPINS_PER_LOOP,
         max_hairpin_bulge: int = hairpin.MAX_HAIRPIN_BULGE,
         energy: BaseEnergy = ViennaEnergy(),
+        energy_top_k: int = 0,
         *args,
         **kwargs,
     ) -> pd.DataFrame:
         """
         Analyze RNA sequence, and predict structure. Return data frame of results
+
+        The attrs of the data frame hold the number of candidates, the number of
+        distinct dot brackets among them, and the number of energy evaluations.
+
+        If energy_top_k is set, only the first energy_top_k results are exact, and
+        energy evaluations that cannot change them are skipped.
+
+        skip_final_au is deprecated and ignored, the pairalign libraries emit the
+        skip-final-AU variants themselves. It will be removed in the next release.
         """
         sequence = sequence.lower()
 
-        pseudoknots = []
-        max_size = {p: 0 for p in pairalign}
-        for (i, j, left_loop_size, dd_size) in parser(sequence):
-            for p in pairalign:
-                knots = p(sequence, i, j, left_loop_size, dd_size)
-                for (dot_bracket, left_loop_stems, right_loop_stems) in knots:
-                    size = left_loop_stems + right_loop_stems
-
-                    if not prune_early or size >= max_size[p] - max_stem_allow_smaller:
-                        max_size[p] = max(max_size[p], size)
-                        pseudoknots.append(
-                            {
-                                "dot_bracket": dot_bracket,
-                                "left_loop_stems": left_loop_stems,
-                                "right_loop_stems": right_loop_stems,
-                                "dd": dd_size,
-                            }
-                        )
-
-                    if not allow_skip_final_au:
-                        continue
-
-                    knots_without_au = skip_final_au(
-                        sequence, dot_bracket, left_loop_stems, right_loop_stems
-                    )
-                    if knots_without_au:
-                        pseudoknots.extend(
-                            {
-                                "dot_bracket": d,
-                                "left_loop_stems": l,
-                                "right_loop_stems": r,
-                                "dd": dd_size,
-                            }
-                            for (d, l, r) in knots_without_au
-                        )
-
-        if not pseudoknots:
-            pseudoknots = [
-                {
-                    "dot_bracket": "." * len(sequence),
-                    "left_loop_stems": 0,
-                    "right_loop_stems": 0,
-                    "dd": 0,
-                }
+        core_stems = _get_core_stems(parser, sequence)
+        pairalign = [getattr(p, "__self__", p) for p in pairalign]
+        for p in pairalign:
+            if not isinstance(p, BasePairAlign):
+                raise TypeError(
+                    f"pairalign must be BasePairAlign instances, got {type(p).__name__}"
+                )
+
+        # candidates of each pairalign, kept compact until dot brackets are needed
+        candidates = []
+        frames = []
+        for idx, p in enumerate(pairalign):
+            rows = p.pairalign_candidates(
+                sequence, core_stems, skip_final_au=bool(allow_skip_final_au)
+            )
+            candidates.append(rows)
+
+            left = rows[:, CANDIDATE["left_loop_stems"]].astype(int)
+            right = rows[:, CANDIDATE["right_loop_stems"]].astype(int)
+            dd = rows[:, CANDIDATE["dd_size"]].astype(int)
+            core_stem = rows[:, CANDIDATE["core_stem"]]
+
+            keep = np.ones(len(rows), dtype=bool)
+            if prune_early and len(rows):
+                # candidates are compared with the largest size seen before them.
+                # variants without the final AU pairs are always kept, and are not
+                # used for the largest size
+                size = left + right
+                skipped_au = rows[:, CANDIDATE["skipped_au"]] != 0
+                max_size = np.where(skipped_au, 0, size)
+                max_size = np.maximum.accumulate(np.concatenate(([0], max_size[:-1])))
+                keep = skipped_au | (size >= max_size - max_stem_allow_smaller)
+
+            frames.append(
+                pd.DataFrame(
+                    {
+                        "dot_bracket": None,
+                        "left_loop_stems": left[keep],
+                        "right_loop_stems": right[keep],
+                        "dd": dd[keep],
+                        "pairalign": idx,
+                        "candidate": np.flatnonzero(keep),
+                        "core_stem": core_stem[keep],
+                    }
+                )
+            )
+
+        def render(data: pd.DataFrame) -> np.ndarray:
+            """
+            Render the dot brackets of the rows that do not have one yet.
+            """
+            dot_brackets = data["dot_bracket"].to_numpy(dtype=object, copy=True)
+            missing = pd.isna(dot_brackets)
+            for idx, p in enumerate(pairalign):
+                mask = missing & (data["pairalign"] == idx).to_numpy()
+                if mask.any():
+                    rows = candidates[idx][data["candidate"].to_numpy()[mask]]
+                    dot_brackets[mask] = p.render_candidates(sequence, rows).astype(str)
+
+            return dot_brackets
+
+        # same order as calling pairalign for each core stem in turn
+        data = pd.concat(frames, ignore_index=True) if frames else pd.DataFrame()
+        if len(data):
+            data = data.sort_values(["core_stem", "pairalign"], kind="stable")
+            data = data.drop(columns=["core_stem"]).reset_index(drop=True)
+
+            # rows with the same dot bracket share the same structure id, so that
+            # each dot bracket is only rendered and evaluated once
+            offsets = np.cumsum([0] + [len(rows) for rows in candidates[:-1]])
+            rows = np.concatenate(candidates)[
+                offsets[data["pairalign"].to_numpy()] + data["candidate"].to_numpy()
             ]
+            data["structure"] = pairalign[0].dedup_candidates(rows)
+        else:
+            data = pd.DataFrame(
+                [
+                    {
+                        "dot_bracket": "." * len(sequence),
+                        "left_loop_stems": 0,
+                        "right_loop_stems": 0,
+                        "dd": 0,
+                        "pairalign": -1,
+                        "candidate": -1,
+                        "structure": 0,
+                    }
+                ]
+            )
+
+        stats = {
+            "candidates": len(data),
+            "unique_candidates": data["structure"].nunique(),
+        }
 
-        data = pd.DataFrame(pseudoknots)
         if csv is not None:
-            data.to_csv(csv)
+            data["dot_bracket"] = render(data)
+            data.drop(columns=["pairalign", "candidate", "structure"]).to_csv(csv)
 
         data = apply_free_energy_and_stems_criterion(
             data,
             sequence,
             max_stem_allow_smaller=max_stem_allow_smaller,
             energy=energy,
+            render=render,
+            top_k=energy_top_k if hairpin_grammar is None else 0,
         )
+        data = data.drop(columns=["pairalign", "candidate", "structure"])
+        stats["energy_evaluations"] = data.attrs["energy_evaluations"]
+        stats["energy_evaluations_skipped"] = data.attrs["energy_evaluations_skipped"]
 
         if hairpin_grammar is None:
+            data.attrs.update(stats)
             return data
 
         data = hairpin.find_hairpins(
@@ -135,6 +199,23 @@ class Knotify(BaseAlgorithm):
             sequence,
             max_stem_allow_smaller=max_stem_allow_smaller,
             energy=energy,
+            top_k=energy_top_k,
         )
+        stats["energy_evaluations"] += data.attrs["energy_evaluations"]
+        stats["energy_evaluations_skipped"] += data.attrs["energy_evaluations_skipped"]
 
+        data.attrs.update(stats)
         return data
+
+
+def _get_core_stems(parser, sequence: str) -> np.ndarray:
+    """
+    Run the parser, and return the core stems as an int32 array with one
+    (i, j, left_loop_size, dd_size) row per core stem.
+    """
+    instance = getattr(parser, "__self__", None)
+    if isinstance(instance, BaseParser):
+        return instance.detect_pseudoknots_packed(sequence)
+
+    results = [tuple(core_stem) for core_stem in parser(sequence)]
+    return np.array(results, dtype=np.int32).reshape(len(results), 4)
@@ -24,6 +24,7 @@ from datetime import datetime
 import json
 import sys
 import logging
+import resource
 
 from oslo_config import cfg
 import yaml
@@ -80,6 +81,10 @@ def run_benchmark(options: knotify.ConfigOpts):
             "count": len(only),
             "duration": 0,
             "confusion_matrix": [0, 0, 0, 0],
+            "candidates": 0,
+            "unique_candidates": 0,
+            "energy_evaluations": 0,
+            "energy_evaluations_skipped": 0,
         },
     }
 
@@ -114,6 +119,19 @@ def run_benchmark(options: knotify.ConfigOpts):
         out["totals"]["truth_in_candidates"] += truth_in_candidates
         out["totals"]["duration"] += duration.total_seconds()
 
+        # candidates with the same dot bracket are only evaluated once
+        stats = {
+            key: results.attrs.get(key, 0)
+            for key in [
+                "candidates",
+                "unique_candidates",
+                "energy_evaluations",
+                "energy_evaluations_skipped",
+            ]
+        }
+        for key, value in stats.items():
+            out["totals"][key] += value
+
         out["totals"]["confusion_matrix"][0] += confusion_matrix[0]
         out["totals"]["confusion_matrix"][1] += confusion_matrix[1]
         out["totals"]["confusion_matrix"][2] += confusion_matrix[2]
@@ -150,6 +168,8 @@ def run_benchmark(options: knotify.ConfigOpts):
             "confusion_matrix": ", ".join(str(x) for x in confusion_matrix),
             "duration": duration.total_seconds(),
             "energy": energy,
+            **stats,
+            "dedup_ratio": _dedup_ratio(stats),
         }
 
         if options.include_candidates:
@@ -158,4 +178,19 @@ def run_benchmark(options: knotify.ConfigOpts):
         if options.include_results:
             out["results"].append(item)
 
+    out["totals"]["dedup_ratio"] = _dedup_ratio(out["totals"])
+
+    # peak resident set size of the process, in KB
+    out["totals"]["peak_memory_kb"] = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+
     return out
+
+
+def _dedup_ratio(stats: dict) -> float:
+    """
+    Fraction of candidates that were dropped as duplicates of another candidate
+    with the same dot bracket.
+    """
+    if not stats["candidates"]:
+        return 0
+    return 1 - stats["unique_candidates"] / stats["candidates"]
@@ -20,16 +20,27 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 #
+from typing import Callable, List, Optional
+
+import numpy as np
 import pandas as pd
 
 from knotify.energy.base import BaseEnergy
 
+# energies and bounds are compared with this tolerance (kcal/mol)
+ENERGY_BOUND_TOLERANCE = 1e-3
+
+# maximum number of dot brackets evaluated at a time with top_k
+TOP_K_CHUNK_SIZE = 256
+
 
 def apply_free_energy_and_stems_criterion(
     data: pd.DataFrame,
     sequence: str,
     max_stem_allow_smaller: int,
     energy: BaseEnergy,
+    render: Optional[Callable[[pd.DataFrame], np.ndarray]] = None,
+    top_k: int = 0,
 ):
     """
     Returns the best result for a Pandas data frame.
@@ -41,6 +52,19 @@ def apply_free_energy_and_stems_criterion(
         "dot_bracket": visualize_knot(knot),
         "dd": str(len(knot.get_dd_seg()))
     }
+
+    If render is set, the dot_bracket column may be missing values. These are
+    filled in with render() only for the rows that pass the stems criterion, so
+    that dot brackets are not created for candidates that are discarded anyway.
+
+    Rows with the same dot bracket are evaluated once. If the data frame has a
+    "structure" column, rows with the same value are expected to have the same
+    dot bracket. Otherwise, rows are compared by their dot bracket.
+
+    If top_k is set, only the first top_k rows are guaranteed to be the same as
+    without it. Dot brackets are evaluated in order of their energy lower bound,
+    and the rest are skipped once their bound is higher than the top_k best
+    energies. Skipped rows have a NaN energy and are sorted last.
     """
     # TODO(akolaitis): Consider supporting "strategies" where smaller number of stems
     # are allowed but are discarded based on energy. Also consider favoring pseudoknots
@@ -59,17 +83,75 @@ def apply_free_energy_and_stems_criterion(
 
     # max stems
     data["stems"] = data["left_loop_stems"] + data["right_loop_stems"]
-    data["real_stems"] = data["dot_bracket"].apply(lambda r: sum(x != "." for x in r))
     data = data[
         data["stems"] >= data["stems"].max() - max_stem_allow_smaller
     ].reset_index()
 
+    # rows with the same dot bracket are only rendered and evaluated once
+    if "structure" in data:
+        structure = data["structure"].to_numpy()
+    else:
+        structure = pd.factorize(data["dot_bracket"])[0]
+    _, first, inverse = np.unique(structure, return_index=True, return_inverse=True)
+    inverse = inverse.reshape(-1)
+
+    if render is not None:
+        data["dot_bracket"] = render(data.iloc[first])[inverse]
+    data["real_stems"] = data["dot_bracket"].apply(lambda r: sum(x != "." for x in r))
+
     # min energy
-    data["energy"] = data["dot_bracket"].apply(lambda r: energy.eval(sequence, r))
+    dot_brackets = data["dot_bracket"].to_numpy()[first]
+    if top_k > 0:
+        energies = _eval_top_k(sequence, list(dot_brackets), energy, top_k)
+    else:
+        energies = np.array(energy.eval_many(sequence, list(dot_brackets)))
+    data["energy"] = energies[inverse]
+    skipped = int(np.count_nonzero(np.isnan(energies)))
+    data.attrs["energy_evaluations"] = len(energies) - skipped
+    data.attrs["energy_evaluations_skipped"] = skipped
     data.sort_values(
-        ["energy", "real_stems", "dd"], ascending=(True, False, True), inplace=True
+        ["energy", "real_stems", "dd"],
+        ascending=(True, False, True),
+        na_position="last",
+        inplace=True,
     )
 
     data = data.reset_index()
 
     return data
+
+
+def _eval_top_k(
+    sequence: str, dot_brackets: List[str], energy: BaseEnergy, top_k: int
+) -> np.ndarray:
+    """
+    Calculate the MFE of the dot brackets, skipping those whose lower bound is
+    higher than the top_k best energies found. Skipped dot brackets are NaN.
+
+    Every skipped dot bracket has a higher energy than at least top_k evaluated
+    ones, so it cannot be among the top_k rows, nor tie with any of them.
+    """
+    bounds = np.asarray(energy.bound_many(sequence, dot_brackets), dtype=np.float64)
+    order = np.argsort(bounds, kind="stable")
+    sorted_bounds = bounds[order]
+
+    energies = np.full(len(dot_brackets), np.nan)
+    end = len(order)
+    done = 0
+    while done < end:
+        # the first top_k are always evaluated, then up to as many as evaluated
+        size = top_k if not done else min(done, TOP_K_CHUNK_SIZE)
+        chunk = order[done : min(done + size, end)]
+        energies[chunk] = energy.eval_many(sequence, [dot_brackets[i] for i in chunk])
+        done += len(chunk)
+
+        if done >= top_k:
+            best = np.partition(energies[order[:done]], top_k - 1)[top_k - 1]
+            end = max(
+                done,
+                np.searchsorted(
+                    sorted_bounds, best + ENERGY_BOUND_TOLERANCE, side="right"
+                ),
+            )
+
+    return energies
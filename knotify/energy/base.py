@@ -20,6 +20,11 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 #
+from typing import List
+
+import numpy as np
+
+
 class BaseEnergy:
     """
     Base class for psuedoknot MFE calculation.
@@ -27,3 +32,17 @@ class BaseEnergy:
 
     def eval(self, sequence: str, dot_bracket: str) -> float:
         raise NotImplementedError
+
+    def eval_many(self, sequence: str, dot_brackets: List[str]) -> list:
+        """
+        Calculate the MFE of many dot brackets of the same sequence. Subclasses
+        may override this with a faster implementation.
+        """
+        return [self.eval(sequence, dot_bracket) for dot_bracket in dot_brackets]
+
+    def bound_many(self, sequence: str, dot_brackets: List[str]) -> np.ndarray:
+        """
+        Calculate a lower bound for the MFE of many dot brackets of the same
+        sequence. The default is -inf, which never allows skipping a dot bracket.
+        """
+        return np.full(len(dot_brackets), -np.inf)
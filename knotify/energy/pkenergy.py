@@ -21,10 +21,17 @@
 # SOFTWARE.
 #
 import ctypes
+from typing import List, Optional, Tuple
+
+import numpy as np
 
 from knotify.energy.base import BaseEnergy
 
 
+# energy model ids, as defined in constantsPK.h
+MODELS = {"re": 0, "dp": 1, "cc2006a": 2, "cc2006b": 3, "cc2006c": 4}
+
+
 class PKEnergy(BaseEnergy):
     """
     Load MFE calculator from a dynamic library. The library should export:
@@ -37,18 +44,213 @@ class PKEnergy(BaseEnergy):
     // will be called for each sequence.
     float get_energy(char *sequence, char *structure);
     ```
+
+    Optionally, a batched version for many structures of the same sequence:
+
+    ```
+    void get_energies(const char *sequence, const char **structures, int n,
+                      double *out);
+
+    // Optional. Same as get_energies(), but split the work across nthreads
+    // threads. If nthreads is not positive, all available cores are used.
+    void get_energies_parallel(const char *sequence, const char **structures,
+                               int n, double *out, int nthreads);
+
+    // Optional. Incremental evaluation: set_base_structure() evaluates and keeps
+    // a structure, get_energy_edit() evaluates it with some base pairs removed
+    // and added, given as pairs of 0-based indices. The result is the same as
+    // get_energy() on the edited structure.
+    double set_base_structure(char *sequence, char *structure);
+    double get_energy_edit(const int *removed, int nremove, const int *added,
+                           int nadd);
+
+    // Optional. Cache the energies of up to entries pseudoknot-free regions in
+    // each thread, for the energy model selected by initialize(). 0 disables
+    // the cache.
+    void set_energy_cache(int entries);
+    void get_energy_cache_stats(long *hits, long *misses);
+
+    // Optional. Lower bound for the MFE of each structure, much cheaper than
+    // get_energies().
+    void get_energy_bounds(const char *sequence, const char **structures, int n,
+                           double *out);
+
+    // Optional. Binary snapshot of the loaded parameters. Both return 0 on
+    // success and -1 on failure.
+    int export_parameters(char *path);
+    int initialize_from_snapshot(char *path, char *model);
+
+    // Optional. Same as get_energy() with each of nmodels energy models (by id,
+    // see MODELS), writing the MFE with models[i] to out[i].
+    void get_energy_multi(char *sequence, char *structure, const int *models,
+                          int nmodels, double *out);
+    ```
+
+    With threads != 1, eval_many() uses get_energies_parallel() if available.
+    With cache_size set, set_energy_cache() is called after initialize().
+    With snapshot set, the parameters are loaded with initialize_from_snapshot(),
+    falling back to initialize() if the snapshot cannot be loaded.
+
+    The library keeps a single energy model and region cache for the whole
+    process, and every PKEnergy selects its own model again. The cache size is
+    kept for each model, so a PKEnergy without cache_size uses the cache size of
+    an earlier PKEnergy with the same model. The cache is cleared, and
+    cache_stats() start over, whenever a PKEnergy is created.
     """
 
-    def __init__(self, library: str, config_dir: str, model: str):
+    def __init__(
+        self,
+        library: str,
+        config_dir: str,
+        model: str,
+        threads: int = 1,
+        cache_size: Optional[int] = None,
+        snapshot: Optional[str] = None,
+    ):
+        self.threads = threads
         self._lib = ctypes.CDLL(library)
         self._lib.get_energy.restype = ctypes.c_double
-        self._lib.initialize(
-            ctypes.c_char_p(config_dir.encode()),
+        if hasattr(self._lib, "get_energy_edit"):
+            self._lib.set_base_structure.restype = ctypes.c_double
+            self._lib.get_energy_edit.restype = ctypes.c_double
+        if not snapshot or not self._initialize_from_snapshot(snapshot, model):
+            self._lib.initialize(
+                ctypes.c_char_p(config_dir.encode()),
+                ctypes.c_char_p(model.encode()),
+            )
+        if cache_size is not None and hasattr(self._lib, "set_energy_cache"):
+            self._lib.set_energy_cache(ctypes.c_int(cache_size))
+
+    def _initialize_from_snapshot(self, snapshot: str, model: str) -> bool:
+        if not hasattr(self._lib, "initialize_from_snapshot"):
+            return False
+
+        result = self._lib.initialize_from_snapshot(
+            ctypes.c_char_p(snapshot.encode()),
             ctypes.c_char_p(model.encode()),
         )
+        return result == 0
+
+    def _require(self, name: str):
+        """
+        Raise if the loaded library does not export an optional entry point.
+        """
+        if not hasattr(self._lib, name):
+            raise NotImplementedError(
+                "{} does not export {}(), rebuild libpkenergy.so".format(
+                    self._lib._name, name
+                )
+            )
+
+    def export_parameters(self, path: str):
+        """
+        Write the loaded parameters to a binary snapshot, which can be passed as
+        snapshot to skip parsing the parameter files.
+        """
+        self._require("export_parameters")
+        if self._lib.export_parameters(ctypes.c_char_p(path.encode())) != 0:
+            raise RuntimeError("failed to write parameter snapshot {}".format(path))
 
     def eval(self, sequence: str, dot_bracket: str) -> float:
         return self._lib.get_energy(
             ctypes.c_char_p(sequence.encode()),
             ctypes.c_char_p(dot_bracket.encode()),
         )
+
+    def eval_many(self, sequence: str, dot_brackets: List[str]) -> np.ndarray:
+        if not hasattr(self._lib, "get_energies"):
+            return np.array(super(PKEnergy, self).eval_many(sequence, dot_brackets))
+
+        structures = (ctypes.c_char_p * len(dot_brackets))(
+            *(dot_bracket.encode() for dot_bracket in dot_brackets)
+        )
+        out = np.zeros(len(dot_brackets), dtype=np.float64)
+        if not len(dot_brackets):
+            return out
+
+        args = [
+            ctypes.c_char_p(sequence.encode()),
+            structures,
+            ctypes.c_int(len(dot_brackets)),
+            out.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+        ]
+        if self.threads != 1 and hasattr(self._lib, "get_energies_parallel"):
+            self._lib.get_energies_parallel(*args, ctypes.c_int(self.threads))
+        else:
+            self._lib.get_energies(*args)
+
+        return out
+
+    def bound_many(self, sequence: str, dot_brackets: List[str]) -> np.ndarray:
+        if not hasattr(self._lib, "get_energy_bounds") or not len(dot_brackets):
+            return super(PKEnergy, self).bound_many(sequence, dot_brackets)
+
+        structures = (ctypes.c_char_p * len(dot_brackets))(
+            *(dot_bracket.encode() for dot_bracket in dot_brackets)
+        )
+        out = np.zeros(len(dot_brackets), dtype=np.float64)
+        self._lib.get_energy_bounds(
+            ctypes.c_char_p(sequence.encode()),
+            structures,
+            ctypes.c_int(len(dot_brackets)),
+            out.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+        )
+        return out
+
+    def eval_models(
+        self, sequence: str, dot_bracket: str, models: List[str]
+    ) -> np.ndarray:
+        """
+        Calculate the MFE of a dot bracket with each of the energy models. The
+        structure is only parsed once for all models.
+        """
+        self._require("get_energy_multi")
+        ids = np.array([MODELS[model] for model in models], dtype=np.int32)
+        out = np.zeros(len(models), dtype=np.float64)
+        self._lib.get_energy_multi(
+            ctypes.c_char_p(sequence.encode()),
+            ctypes.c_char_p(dot_bracket.encode()),
+            ids.ctypes.data_as(ctypes.POINTER(ctypes.c_int)),
+            ctypes.c_int(len(models)),
+            out.ctypes.data_as(ctypes.POINTER(ctypes.c_double)),
+        )
+        return out
+
+    def set_base(self, sequence: str, dot_bracket: str) -> float:
+        """
+        Calculate the MFE of a base structure, and keep it for eval_edit().
+        """
+        self._require("set_base_structure")
+        return self._lib.set_base_structure(
+            ctypes.c_char_p(sequence.encode()),
+            ctypes.c_char_p(dot_bracket.encode()),
+        )
+
+    def eval_edit(
+        self, removed: List[Tuple[int, int]], added: List[Tuple[int, int]]
+    ) -> float:
+        """
+        Calculate the MFE of the last base structure after removing and adding
+        some base pairs (0-based). Only the affected closed regions are
+        evaluated again.
+        """
+        self._require("get_energy_edit")
+        removed = np.array(removed, dtype=np.int32).reshape(-1, 2)
+        added = np.array(added, dtype=np.int32).reshape(-1, 2)
+        return self._lib.get_energy_edit(
+            removed.ctypes.data_as(ctypes.POINTER(ctypes.c_int)),
+            ctypes.c_int(len(removed)),
+            added.ctypes.data_as(ctypes.POINTER(ctypes.c_int)),
+            ctypes.c_int(len(added)),
+        )
+
+    def cache_stats(self) -> Tuple[int, int]:
+        """
+        Return the number of region cache hits and misses.
+        """
+        if not hasattr(self._lib, "get_energy_cache_stats"):
+            return 0, 0
+
+        hits, misses = ctypes.c_long(0), ctypes.c_long(0)
+        self._lib.get_energy_cache_stats(ctypes.byref(hits), ctypes.byref(misses))
+        return hits.value, misses.value
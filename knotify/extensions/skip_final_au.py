@@ -22,6 +22,8 @@
 #
 import ctypes
 
+CALLBACK = ctypes.CFUNCTYPE(None, ctypes.c_char_p, ctypes.c_int, ctypes.c_int)
+
 
 class SkipFinalAU:
     """
@@ -64,14 +66,12 @@ class SkipFinalAU:
         def add_result(dot_bracket, left_loop_stems, right_loop_stems):
             results.append((dot_bracket.decode(), left_loop_stems, right_loop_stems))
 
-        FUNCTYPE = ctypes.CFUNCTYPE(None, ctypes.c_char_p, ctypes.c_int, ctypes.c_int)
-
         self.lib.skip_final_au(
             ctypes.c_char_p(sequence.lower().encode()),
             ctypes.c_char_p(dot_bracket.encode()),
             ctypes.c_int(left_loop_stems),
             ctypes.c_int(right_loop_stems),
-            FUNCTYPE(add_result),
+            CALLBACK(add_result),
         )
 
         return results
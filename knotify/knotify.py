@@ -37,9 +37,9 @@ from knotify.energy.external import ExternalEnergy
 from knotify.energy.pkenergy import PKEnergy
 from knotify.pairalign.cpairalign import CPairAlign
 from knotify.pairalign.bulges import BulgesPairAlign
-from knotify.extensions.skip_final_au import SkipFinalAU
 from knotify.parsers.yaep import YaepParser
 from knotify.parsers.bruteforce import BruteForceParser
+from knotify.parsers.span import SpanParser
 
 CSV_OPTS = [
     cfg.StrOpt("csv"),
@@ -47,9 +47,11 @@ CSV_OPTS = [
 ]
 
 PSEUDOKNOT_OPTS = [
-    cfg.StrOpt("parser", choices=["bruteforce", "yaep"], default="yaep"),
+    cfg.StrOpt("parser", choices=["bruteforce", "yaep", "span"], default="yaep"),
     cfg.StrOpt("yaep-library-path", default="./libpseudoknot.so"),
     cfg.StrOpt("bruteforce-library-path", default="./libbruteforce.so"),
+    cfg.StrOpt("span-library-path", default="./libspan.so"),
+    cfg.IntOpt("parser-threads", default=1),
     cfg.BoolOpt("allow-ug", default=False),
     cfg.IntOpt("max-dd-size", default=2),
     cfg.IntOpt("min-dd-size", default=0),
@@ -68,7 +70,13 @@ PAIRALIGN_OPTS = [
         default=["consecutive"],
     ),
     cfg.BoolOpt("allow-skip-final-au", default=False),
-    cfg.StrOpt("skip-final-au-library-path", default="./libskipfinalau.so"),
+    # unused, the pairalign libraries now emit the skip-final-AU variants
+    cfg.StrOpt(
+        "skip-final-au-library-path",
+        default="./libskipfinalau.so",
+        deprecated_for_removal=True,
+        deprecated_reason="ignored, will be removed in the next release",
+    ),
     cfg.StrOpt("consecutive-pairalign-library-path", default="./libcpairalign.so"),
     cfg.StrOpt("bulges-library-path", default="./libbulges.so"),
     cfg.IntOpt("max-bulge-size", default=1),
@@ -95,6 +103,10 @@ ENERGY_OPTS = [
         default="dp",
         choices=["dp", "re", "cc2006a", "cc2006b", "cc2006c"],
     ),
+    cfg.IntOpt("pkenergy-threads", default=1),
+    cfg.IntOpt("pkenergy-cache-size", default=0),
+    cfg.StrOpt("pkenergy-snapshot"),
+    cfg.IntOpt("energy-top-k", default=0),
     cfg.StrOpt("external-energy-executable"),
 ]
 
@@ -137,6 +149,8 @@ class ConfigOpts(cfg.ConfigOpts):
     parser: str
     yaep_library_path: str
     bruteforce_library_path: str
+    span_library_path: str
+    parser_threads: int
     allow_ug: bool
     max_dd_size: int
     min_dd_size: int
@@ -171,6 +185,10 @@ class ConfigOpts(cfg.ConfigOpts):
     pkenergy: str
     pkenergy_config_dir: str
     pkenergy_model: str
+    pkenergy_threads: int
+    pkenergy_cache_size: int
+    pkenergy_snapshot: str
+    energy_top_k: int
     external_energy_executable: str
 
     # ALGORITHM_OPTS
@@ -218,18 +236,34 @@ def from_options(opts: ConfigOpts) -> Tuple[BaseAlgorithm, dict]:
         "max_window_size_ratio": opts.max_window_size_ratio,
         "min_window_size_ratio": opts.min_window_size_ratio,
         "allow_ug": opts.allow_ug,
+        "threads": opts.parser_threads,
     }
+    # with prune_early, the parser can skip core stems that do not have enough
+    # loop stems. this is only safe if no pairalign counts more stems than that
+    if opts.prune_early and not (
+        "bulges" in opts.pairalign and opts.count_stems_from_bulges
+    ):
+        rna_parser_args["stem_bound"] = opts.max_stem_allow_smaller
     parser = None
     if opts.parser == "yaep":
         parser = YaepParser(opts.yaep_library_path, **rna_parser_args)
     elif opts.parser == "bruteforce":
         parser = BruteForceParser(opts.bruteforce_library_path, **rna_parser_args)
+    elif opts.parser == "span":
+        parser = SpanParser(opts.span_library_path, **rna_parser_args)
 
     energy = None
     if opts.energy == "vienna":
         energy = ViennaEnergy()
     elif opts.energy == "pkenergy":
-        energy = PKEnergy(opts.pkenergy, opts.pkenergy_config_dir, opts.pkenergy_model)
+        energy = PKEnergy(
+            opts.pkenergy,
+            opts.pkenergy_config_dir,
+            opts.pkenergy_model,
+            threads=opts.pkenergy_threads,
+            cache_size=opts.pkenergy_cache_size,
+            snapshot=opts.pkenergy_snapshot,
+        )
     elif opts.energy == "external":
         energy = ExternalEnergy(opts.external_energy_executable)
 
@@ -251,7 +285,7 @@ def from_options(opts: ConfigOpts) -> Tuple[BaseAlgorithm, dict]:
 
     pairalign = []
     if "consecutive" in opts.pairalign:
-        pairalign.append(CPairAlign(opts.consecutive_pairalign_library_path).pairalign)
+        pairalign.append(CPairAlign(opts.consecutive_pairalign_library_path))
     if "bulges" in opts.pairalign:
         pairalign.append(
             BulgesPairAlign(
@@ -260,19 +294,14 @@ def from_options(opts: ConfigOpts) -> Tuple[BaseAlgorithm, dict]:
                 opts.symmetric_bulges,
                 opts.count_stems_from_bulges,
                 library_path=opts.bulges_library_path,
-            ).pairalign
+            )
         )
 
-    skip_final_au = None
-    if opts.allow_skip_final_au:
-        skip_final_au = SkipFinalAU(opts.skip_final_au_library_path).get_candidates
-
     return algorithm, {
         "parser": parser.detect_pseudoknots,
         "csv": opts.csv,
         "allow_ug": opts.allow_ug,
         "pairalign": pairalign,
-        "skip_final_au": skip_final_au,
         "allow_skip_final_au": opts.allow_skip_final_au,
         "max_stem_allow_smaller": opts.max_stem_allow_smaller,
         "prune_early": opts.prune_early,
@@ -283,6 +312,7 @@ def from_options(opts: ConfigOpts) -> Tuple[BaseAlgorithm, dict]:
         "max_hairpin_bulge": opts.max_hairpin_bulge,
         "max_hairpins_per_loop": opts.max_hairpins_per_loop,
         "energy": energy,
+        "energy_top_k": opts.energy_top_k,
         "ipknot_executable": opts.ipknot_executable,
         "knotty_executable": opts.knotty_executable,
         "ihfold_executable": opts.ihfold_executable,
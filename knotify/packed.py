@@ -0,0 +1,69 @@
+#
+# Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+"""
+Helpers for the packed result ABI of the C libraries. Results are returned as
+a single buffer allocated by the library, which is wrapped as a NumPy array
+without copying. The buffer is released with the packed_free() function of the
+library once the array (and all views of it) are garbage collected.
+"""
+import ctypes
+import weakref
+
+import numpy as np
+
+
+def setup(lib: ctypes.CDLL, *functions: str):
+    """
+    Set the return type for packed functions that exist in the library.
+    """
+    for name in functions:
+        if hasattr(lib, name):
+            getattr(lib, name).restype = ctypes.c_void_p
+
+
+def as_int32_array(lib: ctypes.CDLL, address: int, rows: int, width: int):
+    """
+    Wrap a buffer of rows * width int32 values as a (rows, width) array.
+    """
+    if not rows:
+        if address:
+            lib.packed_free(ctypes.c_void_p(address))
+        return np.zeros((0, width), dtype=np.int32)
+
+    buffer = (ctypes.c_int32 * (rows * width)).from_address(address)
+    weakref.finalize(buffer, lib.packed_free, ctypes.c_void_p(address))
+    return np.frombuffer(buffer, dtype=np.int32).reshape(rows, width)
+
+
+def as_bytes_array(lib: ctypes.CDLL, address: int, rows: int, width: int):
+    """
+    Wrap a buffer of rows strings of width bytes each as an array of bytes.
+    """
+    if not rows or not width:
+        if address:
+            lib.packed_free(ctypes.c_void_p(address))
+        return np.full(rows, b"", dtype="S{}".format(max(width, 1)))
+
+    buffer = (ctypes.c_char * (rows * width)).from_address(address)
+    weakref.finalize(buffer, lib.packed_free, ctypes.c_void_p(address))
+    return np.frombuffer(buffer, dtype="S{}".format(width))
@@ -20,12 +20,52 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 #
+import hashlib
+from typing import Tuple
+
+import numpy as np
+
+# columns of the candidates returned by pairalign_candidates(), see the struct
+# candidate in include/candidate.h
+CANDIDATE_FIELDS = (
+    "core_stem",
+    "left_loop_stems",
+    "right_loop_stems",
+    "i",
+    "j",
+    "left_loop_size",
+    "dd_size",
+    "left_stems",
+    "right_stems",
+    "left_bulge_size_left",
+    "left_bulge_size_right",
+    "left_bulge_stems",
+    "right_bulge_size_left",
+    "right_bulge_size_right",
+    "right_bulge_stems",
+    "skipped_au",
+)
+CANDIDATE = {name: idx for idx, name in enumerate(CANDIDATE_FIELDS)}
+
+# columns that determine the dot bracket of a candidate
+CANDIDATE_KEY = slice(CANDIDATE["i"], CANDIDATE["skipped_au"])
+
+# values of the skipped_au column, see include/candidate.h
+SKIPPED_AU_LEFT = 1
+SKIPPED_AU_RIGHT = 2
 
 
 class BasePairAlign:
     """
     Base PairAlign implementation class. Subclasses should extend this and
     implement the pairalign method.
+
+    The batched and compact methods fall back to calling pairalign() for each
+    core stem, subclasses may override them with faster versions. Candidates of
+    the pairalign_candidates() fallback keep their dot brackets in the instance
+    until the next call. Instead of the stems of each loop, they hold a 64-bit
+    hash of the dot bracket, with the sign bit set so that they never match the
+    candidates of a C implementation in dedup_candidates().
     """
 
     def __init__(self, *args, **kwargs):
@@ -38,3 +78,150 @@ class BasePairAlign:
         :return: [(dot_bracket, left_loop_stems, right_loop_stems)]
         """
         raise NotImplementedError
+
+    def pairalign_many(
+        self, sequence: str, core_stems: np.ndarray
+    ) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        Run pairalign for all (i, j, left_loop_size, dd_size) rows of core_stems.
+
+        :return: (rows, dot_brackets). rows is an int32 array with one
+                 (core_stem, left_loop_stems, right_loop_stems) row per result,
+                 where core_stem is the row index in core_stems. dot_brackets is
+                 a bytes array with the dot bracket of each result.
+        """
+        rows, dot_brackets = [], []
+        for idx, core_stem in enumerate(np.asarray(core_stems).tolist()):
+            for (dot_bracket, left, right) in self.pairalign(sequence, *core_stem):
+                rows.append((idx, left, right))
+                dot_brackets.append(dot_bracket.encode())
+
+        return (
+            np.array(rows, dtype=np.int32).reshape(len(rows), 3),
+            np.array(dot_brackets, dtype="S{}".format(max(len(sequence), 1))),
+        )
+
+    def pairalign_candidates(
+        self, sequence: str, core_stems: np.ndarray, skip_final_au: bool = False
+    ) -> np.ndarray:
+        """
+        Same as pairalign_many(), but do not render the dot brackets.
+
+        If skip_final_au is set, each result is followed by its variants without
+        the final AU pair of each loop (see knotify.extensions.skip_final_au).
+        The skipped_au column of these is non-zero.
+
+        :return: an int32 array with one row of CANDIDATE_FIELDS per result.
+                 Use render_candidates() to get the dot brackets of the rows.
+        """
+        core_stems = np.asarray(core_stems, dtype=np.int32).reshape(-1, 4)
+        results, dot_brackets = self.pairalign_many(sequence, core_stems)
+        core_stems = core_stems.tolist()
+
+        self._kept = {}
+        rows = []
+        for (idx, left, right), dot_bracket in zip(
+            results.tolist(), dot_brackets.astype(str).tolist()
+        ):
+            variants = [(dot_bracket, left, right, 0)]
+            if skip_final_au:
+                variants.extend(_skip_final_au(sequence, dot_bracket, left, right))
+
+            for (dot_bracket, left, right, skipped_au) in variants:
+                key = _dot_bracket_key(dot_bracket)
+                self._kept[key] = dot_bracket
+
+                row = [0] * len(CANDIDATE_FIELDS)
+                row[CANDIDATE["core_stem"]] = idx
+                row[CANDIDATE["left_loop_stems"]] = left
+                row[CANDIDATE["right_loop_stems"]] = right
+                row[CANDIDATE["i"] : CANDIDATE["dd_size"] + 1] = core_stems[idx]
+                row[CANDIDATE["left_stems"] : CANDIDATE["right_stems"] + 1] = key
+                row[CANDIDATE["skipped_au"]] = skipped_au
+                rows.append(row)
+
+        return np.array(rows, dtype=np.int32).reshape(len(rows), len(CANDIDATE_FIELDS))
+
+    def render_candidates(self, sequence: str, candidates: np.ndarray) -> np.ndarray:
+        """
+        :return: a bytes array with the dot bracket of each candidate
+        """
+        kept = getattr(self, "_kept", {})
+        keys = np.asarray(candidates).reshape(-1, len(CANDIDATE_FIELDS))[
+            :, CANDIDATE["left_stems"] : CANDIDATE["right_stems"] + 1
+        ]
+        try:
+            dot_brackets = [kept[tuple(key)] for key in keys.tolist()]
+        except KeyError:
+            raise ValueError("candidates were not returned by this pairalign")
+
+        return np.array(dot_brackets, dtype="S{}".format(max(len(sequence), 1)))
+
+    def dedup_candidates(self, candidates: np.ndarray) -> np.ndarray:
+        """
+        Find candidates with the same dot bracket, without rendering them.
+
+        :return: an int32 array with the index of the first candidate that has
+                 the same dot bracket as each candidate.
+        """
+        candidates = np.asarray(candidates)
+        if not len(candidates):
+            return np.zeros(0, dtype=np.int32)
+
+        _, first, inverse = np.unique(
+            candidates[:, CANDIDATE_KEY], axis=0, return_index=True, return_inverse=True
+        )
+        return first[inverse.reshape(-1)].astype(np.int32)
+
+
+def _dot_bracket_key(dot_bracket: str) -> Tuple[int, int]:
+    """
+    Hash a dot bracket to two int32 values, the first of which is negative.
+    """
+    digest = hashlib.blake2b(dot_bracket.encode(), digest_size=8).digest()
+    high = int.from_bytes(digest[:4], "little", signed=True)
+    low = int.from_bytes(digest[4:], "little", signed=True)
+    return (high | -(2**31), low)
+
+
+def _skip_final_au(sequence: str, dot_bracket: str, left: int, right: int) -> list:
+    """
+    Same as pairalign/skipfinalau.c, return the variants of a dot bracket without
+    the final AU pair of the left loop, the right loop, and both.
+
+    :return: [(dot_bracket, left_loop_stems, right_loop_stems, skipped_au)]
+    """
+    sequence = sequence.lower()
+
+    def final_au_pair(stems: int, opening: str, closing: str) -> tuple:
+        if not stems or opening not in dot_bracket:
+            return ()
+        pair = (dot_bracket.index(opening), dot_bracket.rindex(closing))
+        return pair if {sequence[pair[0]], sequence[pair[1]]} == {"a", "u"} else ()
+
+    left_pair = final_au_pair(left, "(", ")")
+    right_pair = final_au_pair(right, "[", "]")
+
+    skip = []
+    if left_pair:
+        skip.append((left_pair, left - 1, right, SKIPPED_AU_LEFT))
+    if right_pair:
+        skip.append((right_pair, left, right - 1, SKIPPED_AU_RIGHT))
+    if left_pair and right_pair:
+        skip.append(
+            (
+                left_pair + right_pair,
+                left - 1,
+                right - 1,
+                SKIPPED_AU_LEFT | SKIPPED_AU_RIGHT,
+            )
+        )
+
+    variants = []
+    for (positions, variant_left, variant_right, skipped_au) in skip:
+        variant = list(dot_bracket)
+        for position in positions:
+            variant[position] = "."
+        variants.append(("".join(variant), variant_left, variant_right, skipped_au))
+
+    return variants
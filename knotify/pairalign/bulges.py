@@ -39,6 +39,7 @@ class BulgesPairAlign(CTypesPairAlign):
         symmetric_bulges: bool,
         count_stems_from_bulges: bool,
         *args,
+        legacy_find_bulge: bool = False,
         **kwargs
     ):
         super(BulgesPairAlign, self).__init__(*args, **kwargs)
@@ -49,3 +50,8 @@ class BulgesPairAlign(CTypesPairAlign):
             ctypes.c_bool(symmetric_bulges),
             ctypes.c_bool(count_stems_from_bulges),
         )
+
+        # bulges are found with lookups in a helix table, unless the legacy
+        # implementation is requested (results are the same)
+        if hasattr(self.lib, "set_legacy_find_bulge"):
+            self.lib.set_legacy_find_bulge(ctypes.c_bool(legacy_find_bulge))
@@ -21,8 +21,14 @@
 # SOFTWARE.
 #
 import ctypes
+from typing import Tuple
 
-from knotify.pairalign.base import BasePairAlign
+import numpy as np
+
+from knotify import packed
+from knotify.pairalign.base import BasePairAlign, CANDIDATE_FIELDS
+
+CALLBACK = ctypes.CFUNCTYPE(None, ctypes.c_char_p, ctypes.c_int, ctypes.c_int)
 
 
 class CTypesPairAlign(BasePairAlign):
@@ -36,6 +42,35 @@ class CTypesPairAlign(BasePairAlign):
                    void (*cb)(char*, int, int));
     ```
 
+    Optionally, a batched version that returns all results at once:
+
+    ```c
+    int32_t *pairalign_many(char *sequence, int32_t *core_stems, int n,
+                            int32_t *count, char **dot_brackets);
+    void packed_free(void *data);
+    ```
+
+    Optionally, a compact version that does not render the dot brackets, see
+    include/candidate.h for the layout of the returned rows:
+
+    ```c
+    int32_t *pairalign_candidates(char *sequence, int32_t *core_stems, int n,
+                                  bool skip_final_au, int32_t *count);
+    char *render_candidates(int32_t *candidates, int n, int len);
+    int dedup_candidates(int32_t *candidates, int n, int32_t *first);
+    ```
+
+    Optionally, a handle for a prepared sequence, so that repeated calls for the
+    same sequence do not need to prepare it again (pairalign() and
+    pairalign_many() also reuse the last prepared sequence automatically):
+
+    ```c
+    void *pairalign_prepare(char *sequence);
+    void pairalign_prepared(void *handle, int i, int j, int left_loop_size,
+                            int dd_size, void (*cb)(char*, int, int));
+    void pairalign_release(void *handle);
+    ```
+
     The implementation is done in C code in pairalign/cpairalign.c
 
     For usage, refer to the unit tests in test/test_pairalign.py
@@ -45,6 +80,9 @@ class CTypesPairAlign(BasePairAlign):
         super(CTypesPairAlign, self).__init__(*args, **kwargs)
 
         self.lib = ctypes.CDLL(library_path)
+        packed.setup(
+            self.lib, "pairalign_many", "pairalign_candidates", "render_candidates"
+        )
 
     def pairalign(
         self, sequence: str, i: int, j: int, left_loop_size: int, dd_size: int
@@ -54,15 +92,86 @@ class CTypesPairAlign(BasePairAlign):
         def add_result(dot_bracket, left_loop_stems, right_loop_stems):
             results.append((dot_bracket.decode(), left_loop_stems, right_loop_stems))
 
-        FUNCTYPE = ctypes.CFUNCTYPE(None, ctypes.c_char_p, ctypes.c_int, ctypes.c_int)
-
         self.lib.pairalign(
             ctypes.c_char_p(sequence.lower().encode()),
             ctypes.c_int(i),
             ctypes.c_int(j),
             ctypes.c_int(left_loop_size),
             ctypes.c_int(dd_size),
-            FUNCTYPE(add_result),
+            CALLBACK(add_result),
         )
 
         return results
+
+    def pairalign_many(
+        self, sequence: str, core_stems: np.ndarray
+    ) -> Tuple[np.ndarray, np.ndarray]:
+        if not hasattr(self.lib, "pairalign_many"):
+            return super(CTypesPairAlign, self).pairalign_many(sequence, core_stems)
+
+        core_stems = np.ascontiguousarray(core_stems, dtype=np.int32)
+        count = ctypes.c_int32()
+        dot_brackets = ctypes.c_void_p()
+        address = self.lib.pairalign_many(
+            ctypes.c_char_p(sequence.lower().encode()),
+            core_stems.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+            ctypes.c_int(len(core_stems)),
+            ctypes.byref(count),
+            ctypes.byref(dot_brackets),
+        )
+
+        return (
+            packed.as_int32_array(self.lib, address, count.value, 3),
+            packed.as_bytes_array(
+                self.lib, dot_brackets.value, count.value, len(sequence)
+            ),
+        )
+
+    def pairalign_candidates(
+        self, sequence: str, core_stems: np.ndarray, skip_final_au: bool = False
+    ) -> np.ndarray:
+        if not hasattr(self.lib, "pairalign_candidates"):
+            return super(CTypesPairAlign, self).pairalign_candidates(
+                sequence, core_stems, skip_final_au
+            )
+
+        core_stems = np.ascontiguousarray(core_stems, dtype=np.int32)
+        count = ctypes.c_int32()
+        address = self.lib.pairalign_candidates(
+            ctypes.c_char_p(sequence.lower().encode()),
+            core_stems.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+            ctypes.c_int(len(core_stems)),
+            ctypes.c_bool(skip_final_au),
+            ctypes.byref(count),
+        )
+
+        return packed.as_int32_array(
+            self.lib, address, count.value, len(CANDIDATE_FIELDS)
+        )
+
+    def render_candidates(self, sequence: str, candidates: np.ndarray) -> np.ndarray:
+        if not hasattr(self.lib, "render_candidates"):
+            return super(CTypesPairAlign, self).render_candidates(sequence, candidates)
+
+        candidates = np.ascontiguousarray(candidates, dtype=np.int32)
+        address = self.lib.render_candidates(
+            candidates.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+            ctypes.c_int(len(candidates)),
+            ctypes.c_int(len(sequence)),
+        )
+
+        return packed.as_bytes_array(self.lib, address, len(candidates), len(sequence))
+
+    def dedup_candidates(self, candidates: np.ndarray) -> np.ndarray:
+        if not hasattr(self.lib, "dedup_candidates"):
+            return super(CTypesPairAlign, self).dedup_candidates(candidates)
+
+        candidates = np.ascontiguousarray(candidates, dtype=np.int32)
+        first = np.empty(len(candidates), dtype=np.int32)
+        self.lib.dedup_candidates(
+            candidates.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+            ctypes.c_int(len(candidates)),
+            first.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
+        )
+
+        return first
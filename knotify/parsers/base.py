@@ -20,6 +20,11 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 #
+from typing import List, Optional
+
+import numpy as np
+
+
 class BaseParser:
     """
     Base RNA parser class. Defines the interface for using the RNA parser, and
@@ -38,6 +43,8 @@ class BaseParser:
         min_window_size: int = 6,
         max_window_size_ratio: float = 0,
         min_window_size_ratio: float = 0,
+        threads: int = 1,
+        stem_bound: Optional[int] = None,
     ):
         self.allow_ug = allow_ug
         self.max_dd_size = max_dd_size
@@ -46,6 +53,11 @@ class BaseParser:
         self.min_window_size = min_window_size
         self.max_window_size_ratio = max_window_size_ratio
         self.min_window_size_ratio = min_window_size_ratio
+        self.threads = threads
+
+        # if not None, parsers may skip core stems that would be discarded by
+        # prune_early, using stem_bound as max_stem_allow_smaller
+        self.stem_bound = stem_bound
 
     def detect_pseudoknots(self, sequence: str) -> list:
         """
@@ -58,3 +70,30 @@ class BaseParser:
         ]
         """
         raise NotImplementedError
+
+    def detect_pseudoknots_packed(self, sequence: str) -> np.ndarray:
+        """
+        Same as detect_pseudoknots(), but return an int32 array with one
+        (left, size, left_loop_size, dd_size) row per pseudoknot.
+        """
+        results = self.detect_pseudoknots(sequence)
+        return np.array(results, dtype=np.int32).reshape(len(results), 4)
+
+    def detect_pseudoknots_many(self, sequences: List[str]) -> List[list]:
+        """
+        Same as detect_pseudoknots(), for a list of sequences. Returns a list with
+        the results of each sequence.
+        """
+        return [self.detect_pseudoknots(sequence) for sequence in sequences]
+
+    def get_stem_bound_stats(self) -> dict:
+        """
+        Return the number of windows and core stems that were checked against
+        the stem bound, and how many of them were skipped.
+        """
+        return {
+            "windows": 0,
+            "windows_skipped": 0,
+            "core_stems": 0,
+            "core_stems_skipped": 0,
+        }
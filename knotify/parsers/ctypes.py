@@ -21,9 +21,17 @@
 # SOFTWARE.
 #
 import ctypes
+from typing import List
 
+import numpy as np
+
+from knotify import packed
 from knotify.parsers.base import BaseParser
 
+CALLBACK = ctypes.CFUNCTYPE(
+    None, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int
+)
+
 
 class CTypesParser(BaseParser):
     """
@@ -46,6 +54,29 @@ class CTypesParser(BaseParser):
     // For each core stem position, the callback function will be executed. See the
     // add_result() definition below for the callback arguments.
     char *detect_pseudoknots(char *sequence, void (*cb)(int, int, int, int, int, int));
+
+    // Optional. Same as detect_pseudoknots(), but split the work across nthreads
+    // workers. Results must be reported in the same order as detect_pseudoknots().
+    void detect_pseudoknots_parallel(char *sequence, int nthreads, void (*cb)(...));
+
+    // Optional. Same as the above, but return all results at once as *count rows
+    // of 4 int32 values, instead of calling back once per result. The returned
+    // buffer is released with packed_free().
+    int32_t *detect_pseudoknots_packed(char *sequence, int32_t *count);
+    int32_t *detect_pseudoknots_parallel_packed(char *sequence, int nthreads,
+                                                int32_t *count);
+
+    // Optional. Same as detect_pseudoknots_packed() for n sequences. Rows of
+    // the k-th sequence are rows [offsets[k], offsets[k + 1]) of the result.
+    int32_t *detect_pseudoknots_batch(const char **sequences, int n,
+                                      int32_t *count, int32_t *offsets);
+    void packed_free(void *data);
+
+    // Optional. Skip core stems that would be discarded by prune_early (see
+    // include/stembound.h), and report how many were skipped as (windows,
+    // windows_skipped, core_stems, core_stems_skipped).
+    void set_stem_bound(int enabled, int max_stem_allow_smaller);
+    void get_stem_bound_stats(int64_t *stats);
     ```
     """
 
@@ -66,19 +97,89 @@ class CTypesParser(BaseParser):
             ctypes.c_float(self.min_window_size_ratio),
             ctypes.c_float(self.max_window_size_ratio),
         )
+        packed.setup(
+            self.lib,
+            "detect_pseudoknots_packed",
+            "detect_pseudoknots_parallel_packed",
+            "detect_pseudoknots_batch",
+        )
+
+        # always reset, the library state is shared with other parsers
+        if hasattr(self.lib, "set_stem_bound"):
+            self.lib.set_stem_bound(
+                ctypes.c_int(self.stem_bound is not None),
+                ctypes.c_int(self.stem_bound or 0),
+            )
 
     def detect_pseudoknots(self, sequence: str) -> list:
+        if hasattr(self.lib, "detect_pseudoknots_packed"):
+            return list(map(tuple, self.detect_pseudoknots_packed(sequence).tolist()))
+
         results = []
 
         def add_result(i, j, left_loop_size, dd_size):
             results.append((i, j, left_loop_size, dd_size))
 
-        FUNCTYPE = ctypes.CFUNCTYPE(
-            None, ctypes.c_int, ctypes.c_int, ctypes.c_int, ctypes.c_int
-        )
+        if self.threads > 1 and hasattr(self.lib, "detect_pseudoknots_parallel"):
+            self.lib.detect_pseudoknots_parallel(
+                ctypes.c_char_p(sequence.lower().encode()),
+                ctypes.c_int(self.threads),
+                CALLBACK(add_result),
+            )
+        else:
+            self.lib.detect_pseudoknots(
+                ctypes.c_char_p(sequence.lower().encode()), CALLBACK(add_result)
+            )
 
-        self.lib.detect_pseudoknots(
-            ctypes.c_char_p(sequence.lower().encode()), FUNCTYPE(add_result)
+        return results
+
+    def detect_pseudoknots_packed(self, sequence: str) -> np.ndarray:
+        count = ctypes.c_int32()
+        if self.threads > 1 and hasattr(self.lib, "detect_pseudoknots_parallel_packed"):
+            address = self.lib.detect_pseudoknots_parallel_packed(
+                ctypes.c_char_p(sequence.lower().encode()),
+                ctypes.c_int(self.threads),
+                ctypes.byref(count),
+            )
+        elif hasattr(self.lib, "detect_pseudoknots_packed"):
+            address = self.lib.detect_pseudoknots_packed(
+                ctypes.c_char_p(sequence.lower().encode()), ctypes.byref(count)
+            )
+        else:
+            return super(CTypesParser, self).detect_pseudoknots_packed(sequence)
+
+        return packed.as_int32_array(self.lib, address, count.value, 4)
+
+    def detect_pseudoknots_many(self, sequences: List[str]) -> List[list]:
+        # the batch entrypoint is single-threaded, parse each sequence separately
+        # so that the parallel entrypoints can be used
+        if self.threads > 1 or not hasattr(self.lib, "detect_pseudoknots_batch"):
+            return super(CTypesParser, self).detect_pseudoknots_many(sequences)
+
+        n = len(sequences)
+        encoded = (ctypes.c_char_p * n)(*(s.lower().encode() for s in sequences))
+        offsets = np.zeros(n + 1, dtype=np.int32)
+        count = ctypes.c_int32()
+        address = self.lib.detect_pseudoknots_batch(
+            encoded,
+            ctypes.c_int(n),
+            ctypes.byref(count),
+            offsets.ctypes.data_as(ctypes.POINTER(ctypes.c_int32)),
         )
 
-        return results
+        rows = packed.as_int32_array(self.lib, address, count.value, 4).tolist()
+        offsets = offsets.tolist()
+        return [list(map(tuple, rows[offsets[k] : offsets[k + 1]])) for k in range(n)]
+
+    def get_stem_bound_stats(self) -> dict:
+        if not hasattr(self.lib, "get_stem_bound_stats"):
+            return super(CTypesParser, self).get_stem_bound_stats()
+
+        stats = (ctypes.c_int64 * 4)()
+        self.lib.get_stem_bound_stats(stats)
+        return dict(
+            zip(
+                ["windows", "windows_skipped", "core_stems", "core_stems_skipped"],
+                stats,
+            )
+        )
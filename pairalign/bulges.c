@@ -22,26 +22,27 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "candidate.h"
+#include "helix.h"
+#include "packed.h"
+#include "sequence.h"
+
 bool gSymmetricBulges;
 bool gCountStemsFromBulges;
 int gMinStemsAfterBulge;
 int gMaxBulgeSize;
+bool gLegacyFindBulge;
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-// IS_PAIR checks for AU, GC, GU, UA, CG, UG pairs
-#define IS_PAIR(a, b) (IS_PAIR_ONEWAY(a, b) || IS_PAIR_ONEWAY(b, a))
-
-// IS_PAIR_ONEWAY checks for AU, GC, GU pairs
-#define IS_PAIR_ONEWAY(a, b)                                                   \
-  (((a) == 'a' && (b) == 'u') || ((a) == 'g' && ((b) == 'c' || (b) == 'u')))
 
 /**
- * \brief given a sequence, attempt to find bulges and extra loop stems
+ * \brief given an encoded sequence, attempt to find bulges and extra loop stems
  *
  * The left loop stems should be in the range [L, R] inclusive.
  * The right loop stems should be in the range [l, r] inclusive.
@@ -67,8 +68,11 @@ int gMaxBulgeSize;
  * o_bulges_size_right == 4    (note: includes l)
  * o_stems == 5
  */
-void find_bulge(char *sequence, int I, int J, int i, int j, bool *o_has_bulge,
-                int *o_bulge_size_left, int *o_bulge_size_right, int *o_stems) {
+void find_bulge_legacy(const struct helix_context *ctx, int I, int J, int i,
+                       int j, bool *o_has_bulge, int *o_bulge_size_left,
+                       int *o_bulge_size_right, int *o_stems) {
+  const struct packed_sequence *ps = &ctx->ps;
+  const struct pair_table *pairs = pair_table_get(1);
 
   *o_has_bulge = false;
   *o_stems = 0;
@@ -85,7 +89,8 @@ void find_bulge(char *sequence, int I, int J, int i, int j, bool *o_has_bulge,
 
       // align stems after bulges
       for (int a = J - leftBulgeSize, b = i + rightBulgeSize;
-           a >= I && b <= j && IS_PAIR(sequence[a], sequence[b]); a--, b++) {
+           a >= I && b <= j && packed_sequence_pairs(ps, pairs, a, b);
+           a--, b++) {
         stems++;
       }
 
@@ -100,6 +105,44 @@ void find_bulge(char *sequence, int I, int J, int i, int j, bool *o_has_bulge,
   }
 }
 
+/**
+ * \brief same as find_bulge_legacy(), using the helix table of the sequence
+ *
+ * The stems after each pair of bulge sizes are a single lookup in the helix
+ * table. With symmetric bulges, only equal bulge sizes are visited. Bulge
+ * sizes are visited in the same order as find_bulge_legacy(), so the same
+ * bulge is chosen when multiple bulges have the same number of stems.
+ */
+void find_bulge(const struct helix_context *ctx, int I, int J, int i, int j,
+                bool *o_has_bulge, int *o_bulge_size_left,
+                int *o_bulge_size_right, int *o_stems) {
+  const struct helix_table *ht = &ctx->helices;
+  int max_left = MIN(J - I - 1, gMaxBulgeSize + 1);
+  int max_right = MIN(j - i - 1, gMaxBulgeSize + 1);
+
+  *o_has_bulge = false;
+  *o_stems = 0;
+
+  for (int leftBulgeSize = 1; leftBulgeSize < max_left; leftBulgeSize++) {
+    int rightBulgeSize = gSymmetricBulges ? leftBulgeSize : 1;
+    int rightBulgeSizeEnd = gSymmetricBulges ? leftBulgeSize + 1 : max_right;
+
+    for (; rightBulgeSize < MIN(rightBulgeSizeEnd, max_right);
+         rightBulgeSize++) {
+      int stems =
+          helix_table_stems(ht, J - leftBulgeSize, i + rightBulgeSize, I, j);
+
+      // found better alignment. criteria is loop size
+      if (stems >= gMinStemsAfterBulge && stems > *o_stems) {
+        *o_has_bulge = true;
+        *o_bulge_size_left = leftBulgeSize;
+        *o_bulge_size_right = rightBulgeSize;
+        *o_stems = stems;
+      }
+    }
+  }
+}
+
 /*
   For simplicity in the code below, the indices of the _core_ loop stems
   are needed. See how each index maps to which sequence position:
@@ -125,53 +168,39 @@ void find_bulge(char *sequence, int I, int J, int i, int j, bool *o_has_bulge,
     L+1 <= a <= R-1       -- in example above a in [4, 9]
     r+1 >= b <= LEN-1     -- in example above b in [23, 27]
 
+  Results are passed to emit as candidates (see include/candidate.h), with
+  the bulges that were found. The dot bracket is only rendered if needed.
 */
-void pairalign(char *sequence, int i, int j, int left_loop_size, int dd_size,
-               void (*cb)(char *, int, int)) {
+static void align(const struct helix_context *ctx, int core_stem, int i, int j,
+                  int left_loop_size, int dd_size, bool skip_final_au,
+                  candidate_emit_fn emit, void *data) {
 
   int L = i;
   int R = i + left_loop_size + 1;
   int l = i + left_loop_size + dd_size + 2;
   int r = i + j - 1;
 
-  char *dot_bracket = strdup(sequence);
-  int left_loop_stems = 0, right_loop_stems = 0;
-
-  // initialize dot bracket
-  int len = strlen(sequence);
-  memset(dot_bracket, '.', len);
-  dot_bracket[L] = '(';
-  dot_bracket[l] = ')';
-  dot_bracket[R] = '[';
-  dot_bracket[r] = ']';
+  int len = ctx->ps.len;
+  struct candidate c = {.core_stem = core_stem,
+                        .i = i,
+                        .j = j,
+                        .left_loop_size = left_loop_size,
+                        .dd_size = dd_size};
 
   // left loop stems
-  left_loop_stems = 0;
-  for (int a = L - 1, b = l + 1; a >= 0 && b <= r - 1; a--, b++) {
-    if (!IS_PAIR(sequence[a], sequence[b])) {
-      break;
-    }
-    dot_bracket[a] = '(';
-    dot_bracket[b] = ')';
-    left_loop_stems++;
-  }
+  int left_loop_stems =
+      helix_table_stems(&ctx->helices, L - 1, l + 1, 0, r - 1);
 
   // right loop stems
-  right_loop_stems = 0;
-  for (int a = R - 1, b = r + 1; a >= L + 1 && b <= len - 1; a--, b++) {
-    if (!IS_PAIR(sequence[a], sequence[b])) {
-      break;
-    }
-    dot_bracket[a] = '[';
-    dot_bracket[b] = ']';
-    right_loop_stems++;
-  }
+  int right_loop_stems =
+      helix_table_stems(&ctx->helices, R - 1, r + 1, L + 1, len - 1);
 
-  cb(dot_bracket, left_loop_stems, right_loop_stems);
+  c.left_stems = c.left_loop_stems = left_loop_stems;
+  c.right_stems = c.right_loop_stems = right_loop_stems;
+  candidate_emit(&c, &ctx->ps, skip_final_au, emit, data);
 
   bool rBulge, lBulge;
-  int rBulgeSizeRight, rBulgeSizeLeft, rStems;
-  int lBulgeSizeRight, lBulgeSizeLeft, lStems;
+  struct candidate_bulge lb, rb;
 
   /*
    * 012345678901234567890123456789012345678901234567890
@@ -193,51 +222,137 @@ void pairalign(char *sequence, int i, int j, int left_loop_size, int dd_size,
    * i = r + right_loop_stems + 1
    * j = len(sequence) - 1
    */
-  find_bulge(sequence, 0, L - left_loop_stems - 1, l + left_loop_stems + 1,
-             r - 1, &lBulge, &lBulgeSizeLeft, &lBulgeSizeRight, &lStems);
+  void (*find)(const struct helix_context *, int, int, int, int, bool *, int *,
+               int *, int *) =
+      gLegacyFindBulge ? find_bulge_legacy : find_bulge;
+
+  find(ctx, 0, L - left_loop_stems - 1, l + left_loop_stems + 1, r - 1,
+       &lBulge, &lb.size_left, &lb.size_right, &lb.stems);
 
-  find_bulge(sequence, L + 1, R - right_loop_stems - 1,
-             r + right_loop_stems + 1, len - 1, &rBulge, &rBulgeSizeLeft,
-             &rBulgeSizeRight, &rStems);
+  find(ctx, L + 1, R - right_loop_stems - 1, r + right_loop_stems + 1,
+       len - 1, &rBulge, &rb.size_left, &rb.size_right, &rb.stems);
+
+  int lCount = left_loop_stems + (gCountStemsFromBulges ? lb.stems : 0);
+  int rCount = right_loop_stems + (gCountStemsFromBulges ? rb.stems : 0);
 
   if (lBulge) {
-    memset(&dot_bracket[L - left_loop_stems - lBulgeSizeLeft - lStems], '(',
-           lStems);
-    memset(&dot_bracket[l + left_loop_stems + 1 + lBulgeSizeRight], ')',
-           lStems);
-
-    cb(dot_bracket, left_loop_stems + (gCountStemsFromBulges ? lStems : 0),
-       right_loop_stems);
-
-    memset(&dot_bracket[L - left_loop_stems - lBulgeSizeLeft - lStems], '.',
-           lStems);
-    memset(&dot_bracket[l + left_loop_stems + 1 + lBulgeSizeRight], '.',
-           lStems);
+    c.left_bulge = lb;
+    c.left_loop_stems = lCount;
+    candidate_emit(&c, &ctx->ps, skip_final_au, emit, data);
+    c.left_bulge = (struct candidate_bulge){0};
+    c.left_loop_stems = left_loop_stems;
   }
 
   if (rBulge) {
-    memset(&dot_bracket[R - right_loop_stems - rBulgeSizeLeft - rStems], '[',
-           rStems);
-    memset(&dot_bracket[r + right_loop_stems + 1 + rBulgeSizeRight], ']',
-           rStems);
-
-    cb(dot_bracket, left_loop_stems,
-       right_loop_stems + (gCountStemsFromBulges ? rStems : 0));
+    c.right_bulge = rb;
+    c.right_loop_stems = rCount;
+    candidate_emit(&c, &ctx->ps, skip_final_au, emit, data);
   }
 
   if (lBulge && rBulge) {
-    memset(&dot_bracket[L - left_loop_stems - lBulgeSizeLeft - lStems], '(',
-           lStems);
-    memset(&dot_bracket[l + left_loop_stems + 1 + lBulgeSizeRight], ')',
-           lStems);
+    c.left_bulge = lb;
+    c.left_loop_stems = lCount;
+    candidate_emit(&c, &ctx->ps, skip_final_au, emit, data);
+  }
+}
+
+// align(), passing the dot bracket of each result to cb
+static void align_callback(const struct helix_context *ctx, int i, int j,
+                           int left_loop_size, int dd_size,
+                           void (*cb)(char *, int, int)) {
+  struct candidate_callback cc = {cb, strdup(ctx->sequence), ctx->ps.len};
+  align(ctx, 0, i, j, left_loop_size, dd_size, false, candidate_callback,
+        &cc);
+  free(cc.dot_bracket);
+}
+
+void pairalign(char *sequence, int i, int j, int left_loop_size, int dd_size,
+               void (*cb)(char *, int, int)) {
+  // pairalign always allows GU pairs
+  const struct helix_context *ctx =
+      helix_context_get(sequence, pair_table_get(1));
+  align_callback(ctx, i, j, left_loop_size, dd_size, cb);
+}
+
+/**
+ * Prepare a sequence for pairalign_prepared(), which skips comparing the
+ * sequence with the previous one on every call. pairalign() prepares and
+ * caches the last sequence of each thread automatically. Release the
+ * returned handle with pairalign_release().
+ **/
+struct helix_context *pairalign_prepare(char *sequence) {
+  return helix_context_new(sequence, pair_table_get(1));
+}
+
+void pairalign_prepared(struct helix_context *ctx, int i, int j,
+                        int left_loop_size, int dd_size,
+                        void (*cb)(char *, int, int)) {
+  align_callback(ctx, i, j, left_loop_size, dd_size, cb);
+}
 
-    cb(dot_bracket, left_loop_stems + (gCountStemsFromBulges ? lStems : 0),
-       right_loop_stems + (gCountStemsFromBulges ? rStems : 0));
+void pairalign_release(struct helix_context *ctx) { helix_context_free(ctx); }
+
+static void collect_candidate(const struct candidate *c, void *data) {
+  candidate_push((struct packed_rows *)data, c);
+}
+
+/**
+ * Run pairalign() for n core stems at once, without rendering dot brackets.
+ * core_stems holds n rows of (i, j, left_loop_size, dd_size), as returned by
+ * detect_pseudoknots_packed().
+ *
+ * Returns *count rows of CANDIDATE_WIDTH values (see include/candidate.h).
+ * With skip_final_au, each result is followed by its variants without the
+ * final AU pair of each loop, see candidate_emit(). Dot brackets can be
+ * rendered with render_candidates(). Release with packed_free().
+ **/
+int32_t *pairalign_candidates(char *sequence, int32_t *core_stems, int n,
+                              bool skip_final_au, int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, CANDIDATE_WIDTH);
+
+  const struct helix_context *ctx =
+      helix_context_get(sequence, pair_table_get(1));
+
+  for (int k = 0; k < n; k++) {
+    int32_t *cs = core_stems + 4 * k;
+    align(ctx, k, cs[0], cs[1], cs[2], cs[3], skip_final_au, collect_candidate,
+          &rows);
+  }
+
+  return packed_rows_release(&rows, count);
+}
+
+/**
+ * Run pairalign() for n core stems at once. core_stems holds n rows of
+ * (i, j, left_loop_size, dd_size), as returned by detect_pseudoknots_packed().
+ *
+ * Returns *count rows of (core_stem, left_loop_stems, right_loop_stems), where
+ * core_stem is the row index in core_stems. The dot bracket of each row is
+ * stored in *dot_brackets, strlen(sequence) characters per row without any
+ * terminators. Release both with packed_free().
+ **/
+int32_t *pairalign_many(char *sequence, int32_t *core_stems, int n,
+                        int32_t *count, char **dot_brackets) {
+  int32_t *candidates =
+      pairalign_candidates(sequence, core_stems, n, false, count);
+  int32_t *rows = malloc((size_t)*count * 3 * sizeof(int32_t) + 1);
+
+  for (int k = 0; k < *count; k++) {
+    struct candidate *c =
+        (struct candidate *)(candidates + k * CANDIDATE_WIDTH);
+    rows[3 * k] = c->core_stem;
+    rows[3 * k + 1] = c->left_loop_stems;
+    rows[3 * k + 2] = c->right_loop_stems;
   }
 
-  free(dot_bracket);
+  *dot_brackets = render_candidates(candidates, *count, strlen(sequence));
+  free(candidates);
+  return rows;
 }
 
+void packed_free(void *data) { free(data); }
+
 void initialize(int max_bulge_size, int min_stems_after_bulge,
                 bool symmetric_bulges, bool count_stems_from_bulges) {
   gSymmetricBulges = symmetric_bulges;
@@ -245,3 +360,9 @@ void initialize(int max_bulge_size, int min_stems_after_bulge,
   gMinStemsAfterBulge = min_stems_after_bulge;
   gCountStemsFromBulges = count_stems_from_bulges;
 }
+
+/**
+ * Use find_bulge_legacy() instead of find_bulge(). Both give the same results,
+ * the legacy implementation is kept for comparison.
+ **/
+void set_legacy_find_bulge(bool legacy) { gLegacyFindBulge = legacy; }
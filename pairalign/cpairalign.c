@@ -21,18 +21,19 @@
  * SOFTWARE.
  */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#include "candidate.h"
+#include "helix.h"
+#include "packed.h"
+#include "sequence.h"
 
-// IS_PAIR checks for AU, GC, GU, UA, CG, UG pairs
-#define IS_PAIR(a, b) (IS_PAIR_ONEWAY(a, b) || IS_PAIR_ONEWAY(b, a))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-// IS_PAIR_ONEWAY checks for AU, GC, GU pairs
-#define IS_PAIR_ONEWAY(a, b)                                                   \
-  (((a) == 'a' && (b) == 'u') || ((a) == 'g' && ((b) == 'c' || (b) == 'u')))
 
 /*
   For simplicity in the code below, the indices of the _core_ loop stems
@@ -59,49 +60,131 @@
     L+1 <= a <= R-1       -- in example above a in [4, 9]
     r+1 >= b <= LEN-1     -- in example above b in [23, 27]
 
+  The number of loop stems is looked up in the helix table of the sequence,
+  instead of checking each pair. Results are passed to emit as candidates
+  (see include/candidate.h), the dot bracket is only rendered if needed.
 */
-void pairalign(char *sequence, int i, int j, int left_loop_size, int dd_size,
-               void (*cb)(char *, int, int)) {
+static void align(const struct helix_context *ctx, int core_stem, int i, int j,
+                  int left_loop_size, int dd_size, bool skip_final_au,
+                  candidate_emit_fn emit, void *data) {
 
   int L = i;
   int R = i + left_loop_size + 1;
   int l = i + left_loop_size + dd_size + 2;
   int r = i + j - 1;
 
-  char *dot_bracket = strdup(sequence);
-  int left_loop_stems = 0, right_loop_stems = 0;
-
-  // initialize dot bracket
-  int len = strlen(sequence);
-  memset(dot_bracket, '.', len);
-  dot_bracket[L] = '(';
-  dot_bracket[l] = ')';
-  dot_bracket[R] = '[';
-  dot_bracket[r] = ']';
+  int len = ctx->ps.len;
+  struct candidate c = {.core_stem = core_stem,
+                        .i = i,
+                        .j = j,
+                        .left_loop_size = left_loop_size,
+                        .dd_size = dd_size};
 
   // left loop stems
-  left_loop_stems = 0;
-  for (int a = L - 1, b = l + 1; a >= 0 && b <= r - 1; a--, b++) {
-    if (!IS_PAIR(sequence[a], sequence[b])) {
-      break;
-    }
-    dot_bracket[a] = '(';
-    dot_bracket[b] = ')';
-    left_loop_stems++;
-  }
+  c.left_stems = helix_table_stems(&ctx->helices, L - 1, l + 1, 0, r - 1);
 
   // right loop stems
-  right_loop_stems = 0;
-  for (int a = R - 1, b = r + 1; a >= L + 1 && b <= len - 1; a--, b++) {
-    if (!IS_PAIR(sequence[a], sequence[b])) {
-      break;
-    }
-    dot_bracket[a] = '[';
-    dot_bracket[b] = ']';
-    right_loop_stems++;
+  c.right_stems =
+      helix_table_stems(&ctx->helices, R - 1, r + 1, L + 1, len - 1);
+
+  c.left_loop_stems = c.left_stems;
+  c.right_loop_stems = c.right_stems;
+  candidate_emit(&c, &ctx->ps, skip_final_au, emit, data);
+}
+
+// align(), passing the dot bracket of each result to cb
+static void align_callback(const struct helix_context *ctx, int i, int j,
+                           int left_loop_size, int dd_size,
+                           void (*cb)(char *, int, int)) {
+  struct candidate_callback cc = {cb, strdup(ctx->sequence), ctx->ps.len};
+  align(ctx, 0, i, j, left_loop_size, dd_size, false, candidate_callback,
+        &cc);
+  free(cc.dot_bracket);
+}
+
+void pairalign(char *sequence, int i, int j, int left_loop_size, int dd_size,
+               void (*cb)(char *, int, int)) {
+  // pairalign always allows GU pairs
+  const struct helix_context *ctx =
+      helix_context_get(sequence, pair_table_get(1));
+  align_callback(ctx, i, j, left_loop_size, dd_size, cb);
+}
+
+/**
+ * Prepare a sequence for pairalign_prepared(), which skips comparing the
+ * sequence with the previous one on every call. pairalign() prepares and
+ * caches the last sequence of each thread automatically. Release the
+ * returned handle with pairalign_release().
+ **/
+struct helix_context *pairalign_prepare(char *sequence) {
+  return helix_context_new(sequence, pair_table_get(1));
+}
+
+void pairalign_prepared(struct helix_context *ctx, int i, int j,
+                        int left_loop_size, int dd_size,
+                        void (*cb)(char *, int, int)) {
+  align_callback(ctx, i, j, left_loop_size, dd_size, cb);
+}
+
+void pairalign_release(struct helix_context *ctx) { helix_context_free(ctx); }
+
+static void collect_candidate(const struct candidate *c, void *data) {
+  candidate_push((struct packed_rows *)data, c);
+}
+
+/**
+ * Run pairalign() for n core stems at once, without rendering dot brackets.
+ * core_stems holds n rows of (i, j, left_loop_size, dd_size), as returned by
+ * detect_pseudoknots_packed().
+ *
+ * Returns *count rows of CANDIDATE_WIDTH values (see include/candidate.h).
+ * With skip_final_au, each result is followed by its variants without the
+ * final AU pair of each loop, see candidate_emit(). Dot brackets can be
+ * rendered with render_candidates(). Release with packed_free().
+ **/
+int32_t *pairalign_candidates(char *sequence, int32_t *core_stems, int n,
+                              bool skip_final_au, int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, CANDIDATE_WIDTH);
+
+  const struct helix_context *ctx =
+      helix_context_get(sequence, pair_table_get(1));
+
+  for (int k = 0; k < n; k++) {
+    int32_t *cs = core_stems + 4 * k;
+    align(ctx, k, cs[0], cs[1], cs[2], cs[3], skip_final_au, collect_candidate,
+          &rows);
   }
 
-  cb(dot_bracket, left_loop_stems, right_loop_stems);
+  return packed_rows_release(&rows, count);
+}
 
-  free(dot_bracket);
+/**
+ * Run pairalign() for n core stems at once. core_stems holds n rows of
+ * (i, j, left_loop_size, dd_size), as returned by detect_pseudoknots_packed().
+ *
+ * Returns *count rows of (core_stem, left_loop_stems, right_loop_stems), where
+ * core_stem is the row index in core_stems. The dot bracket of each row is
+ * stored in *dot_brackets, strlen(sequence) characters per row without any
+ * terminators. Release both with packed_free().
+ **/
+int32_t *pairalign_many(char *sequence, int32_t *core_stems, int n,
+                        int32_t *count, char **dot_brackets) {
+  int32_t *candidates =
+      pairalign_candidates(sequence, core_stems, n, false, count);
+  int32_t *rows = malloc((size_t)*count * 3 * sizeof(int32_t) + 1);
+
+  for (int k = 0; k < *count; k++) {
+    struct candidate *c =
+        (struct candidate *)(candidates + k * CANDIDATE_WIDTH);
+    rows[3 * k] = c->core_stem;
+    rows[3 * k + 1] = c->left_loop_stems;
+    rows[3 * k + 2] = c->right_loop_stems;
+  }
+
+  *dot_brackets = render_candidates(candidates, *count, strlen(sequence));
+  free(candidates);
+  return rows;
 }
+
+void packed_free(void *data) { free(data); }
@@ -25,7 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define IS_AU(a, b) ((a) == 'a' && (b) == 'u' || (a) == 'u' && (b) == 'a')
+#include "sequence.h"
 
 /*
   For simplicity in the code below, the indices of the _last_ loop stems
@@ -41,12 +41,13 @@
 */
 void skip_final_au(char *sequence, char *dot_bracket, int left_loop_stems,
                    int right_loop_stems, void (*cb)(char *, int, int)) {
+  const struct packed_sequence *ps = packed_sequence_get(sequence);
   int L = -1, l = -1, R = -1, r = -1;
 
   char *bracket = strdup(dot_bracket);
 
   // find indices of last loop stems
-  for (int i = 0; i < strlen(sequence); i++) {
+  for (int i = 0; i < ps->len; i++) {
     if (bracket[i] == '(' && L == -1) {
       L = i;
     } else if (bracket[i] == '[' && R == -1) {
@@ -59,8 +60,8 @@ void skip_final_au(char *sequence, char *dot_bracket, int left_loop_stems,
   }
 
   // left loop stem ends with an AU pair
-  int left_is_au = left_loop_stems > 0 && IS_AU(sequence[L], sequence[l]);
-  int right_is_au = right_loop_stems > 0 && IS_AU(sequence[R], sequence[r]);
+  int left_is_au = left_loop_stems > 0 && packed_sequence_is_au(ps, L, l);
+  int right_is_au = right_loop_stems > 0 && packed_sequence_is_au(ps, R, r);
 
   if (left_is_au) {
     bracket[L] = bracket[l] = '.';
@@ -24,17 +24,26 @@
 // Description: Brute force library for detecting positions of core stems
 // of pseudoknot in an RNA sequence.
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct stem {
-  unsigned char left, right; // [0..255]
-} stem;
+#include "bitset.h"
+#include "packed.h"
+#include "sequence.h"
+#include "stembound.h"
 
-typedef struct core_stem {
-  stem cstem[2];
-} core_stem;
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// receives (left, size, left_loop_size, dd_size) for each detected core stem
+typedef void (*emit_func)(void *data, int left, int size, int left_loop_size,
+                          int dd_size);
 
 static int s_allow_ug;
 static int s_min_dd_size;
@@ -44,6 +53,11 @@ static int s_max_window_size;
 static float s_min_window_size_ratio;
 static float s_max_window_size_ratio;
 
+// see set_stem_bound()
+static int s_stem_bound_enabled;
+static int s_stem_bound_allow_smaller;
+static struct stem_bound_stats s_stem_bound_stats;
+
 void initialize(char *_grammar_unused, int _allow_ug, int _min_dd_size,
                 int _max_dd_size, int _min_window_size, int _max_window_size,
                 float _min_window_size_ratio, float _max_window_size_ratio) {
@@ -60,128 +74,259 @@ void initialize(char *_grammar_unused, int _allow_ug, int _min_dd_size,
   //        min_window_size, max_window_size);
 }
 
-void detect_pseudoknots(char *sequence, void (*cb)(int, int, int, int)) {
-  int n = strlen(sequence);
+/**
+ * Per-sequence scan state. partners[n] is a bitset of all positions that can
+ * pair with nucleotide n, so the partners of a position are found a word at a
+ * time instead of comparing every character.
+ **/
+struct scan_state {
+  const struct packed_sequence *ps;
+  int n;
+  int min_window_size;
+  int max_window_size;
+  int words;
+  uint64_t *partners[4];
+};
+
+static void scan_init(struct scan_state *st, const char *sequence) {
+  st->ps = packed_sequence_get(sequence);
+  st->n = st->ps->len;
+  st->words = st->ps->words;
 
   // window size is static or ratio of sequence length
-  int min_window_size =
-      s_min_window_size ? s_min_window_size : (n * s_min_window_size_ratio);
-  int max_window_size =
-      s_max_window_size ? s_max_window_size : (n * s_max_window_size_ratio);
-
-  stem *all_stems = (stem *)malloc(n * n * sizeof(stem));
-  stem *cs_position = all_stems;
-  stem *cs_position2 = all_stems;
-
-  long int n_stems = 0;
-  long int n_cstems = 0;
-
-  for (int i = 0; i < n; i++) {
-    switch (sequence[i]) {
-    case 'a':
-      for (int j = i + 1; j < n; j++)
-        if (sequence[j] == 'u') {
-          cs_position->left = i;
-          cs_position->right = j;
-          cs_position++;
-          n_stems++;
-        }
-      break;
-    case 'u':
-      for (int j = i + 1; j < n; j++)
-        if ((sequence[j] == 'a') || ((sequence[j] == 'g') && s_allow_ug)) {
-          cs_position->left = i;
-          cs_position->right = j;
-          cs_position++;
-          n_stems++;
-        }
-      break;
-    case 'c':
-      for (int j = i + 1; j < n; j++)
-        if (sequence[j] == 'g') {
-          cs_position->left = i;
-          cs_position->right = j;
-          cs_position++;
-          n_stems++;
-        }
-      break;
-    case 'g':
-      for (int j = i + 1; j < n; j++)
-        if ((sequence[j] == 'c') || ((sequence[j] == 'u') && s_allow_ug)) {
-          cs_position->left = i;
-          cs_position->right = j;
-          cs_position++;
-          n_stems++;
-        }
-      break;
-    default:
-      printf("Invalid character\n");
-    }
+  st->min_window_size = s_min_window_size ? s_min_window_size
+                                          : (st->n * s_min_window_size_ratio);
+  st->max_window_size = s_max_window_size ? s_max_window_size
+                                          : (st->n * s_max_window_size_ratio);
+
+  const struct pair_table *pairs = pair_table_get(s_allow_ug);
+  st->partners[0] = malloc((4 * st->words + 1) * sizeof(uint64_t));
+  for (int n = 0; n < 4; n++) {
+    st->partners[n] = st->partners[0] + n * st->words;
+    packed_sequence_partners(st->ps, pairs, n, st->partners[n]);
   }
+}
 
-  // printf("Stems (size: %ld): \n", n_stems);
-  // cs_position = all_stems;
-  for (int i = 0; i < n_stems; i++) {
-    cs_position = all_stems + i;
-    // printf("%d) \t%d %d\n", i, cs_position->left, cs_position->right);
+static void scan_free(struct scan_state *st) { free(st->partners[0]); }
+
+/*
+  A core stem consists of two stems (L, l) and (R, r), such that:
+
+  BRACKET  = (......[....)......]
+  NOTATION = L......R....l......r
+
+  L < R - 1                               -- left loop is not empty
+  min_dd_size <= l - R - 1 <= max_dd_size -- dd size
+  l < r - 1                               -- right loop is not empty
+  min_window_size <= r - L + 1 <= max_window_size
+
+  Core stems are enumerated by (L, l, R, r) in lexicographic order, and only
+  the positions of R and r that satisfy the dd size and window size bounds
+  are visited. No stems are stored, so memory use does not depend on the
+  number of stems.
+
+  scan_left() reports all core stems for a single L, so that the work can be
+  split across threads by L. Results for each L are then reported in order.
+*/
+static void scan_left(const struct scan_state *st, int L, emit_func emit,
+                      void *data) {
+  if (!packed_sequence_valid(st->ps, L)) {
+    printf("Invalid character\n");
+    return;
   }
 
-  // printf("eftasa edo\n");
-  core_stem *all_cstems = malloc(n_stems * n_stems * sizeof(core_stem)); // zong
-  core_stem *ccs_position = all_cstems;
-
-  cs_position = all_stems;
-  cs_position2 = all_stems;
-  ccs_position = all_cstems;
-
-  for (int i = 0; i < n_stems; i++) {
-    cs_position = all_stems + i;
-    for (int j = i + 1; j < n_stems; j++) {
-      cs_position2 = all_stems + j;
-      if ((cs_position->left < cs_position2->left) &&
-          (cs_position2->left < cs_position->right) &&
-          (cs_position->right < cs_position2->right)) {
-        // printf("petixe %ld) %d %d\n",n_cstems,i,j);
-        (ccs_position->cstem[0]).left = cs_position->left;
-        (ccs_position->cstem[0]).right = cs_position->right;
-        (ccs_position->cstem[1]).left = cs_position2->left;
-        (ccs_position->cstem[1]).right = cs_position2->right;
-
-        ccs_position++;
-        n_cstems++;
+  // last position of r in the window
+  int r_hi = MIN(L + st->max_window_size - 1, st->n - 1);
+
+  const uint64_t *l_partners = st->partners[packed_sequence_at(st->ps, L)];
+  for (int l = bitset_next(l_partners, st->words, L + 3);
+       l >= 0 && l <= r_hi - 2; l = bitset_next(l_partners, st->words, l + 1)) {
+    int R_lo = MAX(l - 1 - s_max_dd_size, L + 2);
+    int R_hi = l - 1 - s_min_dd_size;
+    int r_lo = MAX(l + 2, L + st->min_window_size - 1);
+
+    for (int R = R_lo; R <= R_hi; R++) {
+      if (!packed_sequence_valid(st->ps, R)) {
+        continue;
+      }
+
+      const uint64_t *r_partners = st->partners[packed_sequence_at(st->ps, R)];
+      for (int r = bitset_next(r_partners, st->words, r_lo);
+           r >= 0 && r <= r_hi; r = bitset_next(r_partners, st->words, r + 1)) {
+        emit(data, L, r - L + 1, R - L - 1, l - R - 1);
       }
     }
   }
+}
+
+/**
+ * Wraps an emit_func, and only reports core stems that pass the stem bound.
+ **/
+struct bounded_emit {
+  struct stem_bound bound;
+  emit_func emit;
+  void *data;
+};
+
+static void emit_bounded(void *data, int left, int size, int left_loop_size,
+                         int dd_size) {
+  struct bounded_emit *b = data;
+  if (stem_bound_skip_core_stem(&b->bound, left, size, left_loop_size,
+                                dd_size)) {
+    return;
+  }
+  b->emit(b->data, left, size, left_loop_size, dd_size);
+}
+
+static void emit_to_packed(void *data, int left, int size, int left_loop_size,
+                           int dd_size);
+
+/**
+ * Scan a sequence with nthreads threads. Core stems are reported in the same
+ * order for any number of threads. With the stem bound enabled, core stems
+ * are collected first and checked against the bound in order, so that the
+ * same core stems are skipped as well.
+ **/
+static void scan_parallel(const char *sequence, int nthreads, emit_func emit,
+                          void *data) {
+  struct scan_state st;
+  scan_init(&st, sequence);
+
+  struct bounded_emit bounded;
+  if (s_stem_bound_enabled) {
+    stem_bound_init(&bounded.bound, st.ps, s_stem_bound_allow_smaller,
+                    &s_stem_bound_stats);
+    bounded.emit = emit;
+    bounded.data = data;
+    emit = emit_bounded;
+    data = &bounded;
+  }
+
+#ifdef _OPENMP
+  if (nthreads > 1 && st.n > 0) {
+    // results of each L, reported in order after all threads are done
+    struct packed_rows *rows = malloc(st.n * sizeof(struct packed_rows));
+    for (int L = 0; L < st.n; L++) {
+      packed_rows_init(&rows[L], 4);
+    }
 
-  // printf("Core_Stems (size: %ld): \n", n_cstems);
-  ccs_position = all_cstems;
-  for (int i = 0; i < n_cstems; i++) {
-    int left = (ccs_position->cstem[0]).left;
-    int size = (ccs_position->cstem[1]).right - ccs_position->cstem[0].left + 1;
-    int left_loop_size =
-        ccs_position->cstem[1].left - ccs_position->cstem[0].left - 1;
-    int dd_size =
-        (ccs_position->cstem[0]).right - ccs_position->cstem[1].left - 1;
-
-    // TODO (akolaitis): improve this
-    if (size < min_window_size || size > max_window_size ||
-        dd_size < s_min_dd_size || dd_size > s_max_dd_size ||
-        left_loop_size == 0 ||
-        (ccs_position->cstem[0].right == ccs_position->cstem[1].right - 1)) {
-      // printf("RIP! %d,%d,%d,%d\n", left, size, left_loop_size, dd_size);
-
-      ccs_position++;
-      continue;
+    // shorter values of L have more core stems, so hand them out one by one
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 1)
+    for (int L = 0; L < st.n; L++) {
+      scan_left(&st, L, emit_to_packed, &rows[L]);
     }
 
-    cb(left, size, left_loop_size, dd_size);
-    // printf("(%d %d) - (%d %d) \t\t (%c, %c) - (%c, %c) \n",
-    //        (ccs_position->cstem[0]).left, (ccs_position->cstem[0]).right,
-    //        (ccs_position->cstem[1]).left, (ccs_position->cstem[1]).right,
-    //        sequence[(ccs_position->cstem[0]).left],
-    //        sequence[(ccs_position->cstem[0]).right],
-    //        sequence[(ccs_position->cstem[1]).left],
-    //        sequence[(ccs_position->cstem[1]).right]);
-    ccs_position++;
+    for (int L = 0; L < st.n; L++) {
+      for (size_t i = 0; i < rows[L].count; i++) {
+        int32_t *row = rows[L].data + 4 * i;
+        emit(data, row[0], row[1], row[2], row[3]);
+      }
+      free(rows[L].data);
+    }
+    free(rows);
+  } else
+#endif
+  {
+    for (int L = 0; L < st.n; L++) {
+      scan_left(&st, L, emit, data);
+    }
+  }
+
+  if (s_stem_bound_enabled) {
+    stem_bound_free(&bounded.bound);
+  }
+  scan_free(&st);
+}
+
+static void scan(const char *sequence, emit_func emit, void *data) {
+  scan_parallel(sequence, 1, emit, data);
+}
+
+static void emit_to_callback(void *data, int left, int size,
+                             int left_loop_size, int dd_size) {
+  void (*cb)(int, int, int, int) = (void (*)(int, int, int, int))data;
+  cb(left, size, left_loop_size, dd_size);
+}
+
+static void emit_to_packed(void *data, int left, int size, int left_loop_size,
+                           int dd_size) {
+  int32_t *row = packed_rows_push((struct packed_rows *)data);
+  row[0] = left;
+  row[1] = size;
+  row[2] = left_loop_size;
+  row[3] = dd_size;
+}
+
+void detect_pseudoknots(char *sequence, void (*cb)(int, int, int, int)) {
+  scan(sequence, emit_to_callback, (void *)cb);
+}
+
+/**
+ * Same as detect_pseudoknots(), but return all results at once, as *count
+ * rows of (left, size, left_loop_size, dd_size). Release with packed_free().
+ **/
+int32_t *detect_pseudoknots_packed(char *sequence, int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  scan(sequence, emit_to_packed, &rows);
+  return packed_rows_release(&rows, count);
+}
+
+/**
+ * Run detect_pseudoknots_packed() for n sequences at once. The rows of the
+ * k-th sequence are rows [offsets[k], offsets[k + 1]) of the returned buffer,
+ * so offsets must have room for n + 1 values. Release with packed_free().
+ **/
+int32_t *detect_pseudoknots_batch(const char **sequences, int n,
+                                  int32_t *count, int32_t *offsets) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  for (int k = 0; k < n; k++) {
+    offsets[k] = rows.count;
+    scan(sequences[k], emit_to_packed, &rows);
   }
+  offsets[n] = rows.count;
+  return packed_rows_release(&rows, count);
+}
+
+void packed_free(void *data) { free(data); }
+
+/**
+ * Same as detect_pseudoknots(), but split the work across nthreads threads.
+ * Results are reported in the same order as detect_pseudoknots().
+ **/
+void detect_pseudoknots_parallel(char *sequence, int nthreads,
+                                 void (*cb)(int, int, int, int)) {
+  scan_parallel(sequence, nthreads, emit_to_callback, (void *)cb);
+}
+
+int32_t *detect_pseudoknots_parallel_packed(char *sequence, int nthreads,
+                                            int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  scan_parallel(sequence, nthreads, emit_to_packed, &rows);
+  return packed_rows_release(&rows, count);
+}
+
+/**
+ * Enable or disable the stem bound (see stembound.h). With the bound enabled,
+ * core stems that would be discarded by prune_early with the same
+ * max_stem_allow_smaller are not reported. Also resets the statistics.
+ **/
+void set_stem_bound(int enabled, int max_stem_allow_smaller) {
+  s_stem_bound_enabled = enabled;
+  s_stem_bound_allow_smaller = max_stem_allow_smaller;
+  memset(&s_stem_bound_stats, 0, sizeof(s_stem_bound_stats));
+}
+
+/**
+ * Store the number of windows, skipped windows, core stems and skipped core
+ * stems since the last call to set_stem_bound() in stats[0..3]. Windows are
+ * always 0, since core stems are not grouped in windows.
+ **/
+void get_stem_bound_stats(int64_t *stats) {
+  stats[0] = s_stem_bound_stats.windows;
+  stats[1] = s_stem_bound_stats.windows_skipped;
+  stats[2] = s_stem_bound_stats.core_stems;
+  stats[3] = s_stem_bound_stats.core_stems_skipped;
 }
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "arena.h"
 #include "hashtab.h"
 #include "objstack.h"
 #include "yaep.h"
@@ -36,6 +37,16 @@
 static char *input;
 static int ntok;
 
+// compiled grammar, reused while the grammar description does not change
+static char *s_description;
+static struct grammar *s_grammar;
+
+// parse tree and hairpin lists, reset at the end of each detect_hairpins()
+static struct arena s_arena;
+
+// result of the last detect_hairpins() call
+static char *s_result;
+
 static int read_token_func(void **attr) {
   *attr = NULL;
   if (input[ntok]) {
@@ -62,12 +73,12 @@ static void syntax_error_func(int err_tok_num, void *err_tok_attr,
   }
 }
 
-static void *parse_alloc_func(int size) { return malloc(size); }
+static void *parse_alloc_func(int size) {
+  return arena_alloc(&s_arena, size);
+}
 
-struct yaep_tree_node *parse(const char *description) {
+static struct grammar *compile_grammar(const char *description) {
   struct grammar *g;
-  struct yaep_tree_node *root;
-  int ambiguous_p;
 
   if ((g = yaep_create_grammar()) == NULL) {
     fprintf(stderr, "yaep_create_grammar: No memory\n");
@@ -84,6 +95,24 @@ struct yaep_tree_node *parse(const char *description) {
     fprintf(stderr, "%s\n", yaep_error_message(g));
     exit(1);
   }
+  return g;
+}
+
+struct yaep_tree_node *parse(const char *description) {
+  struct yaep_tree_node *root;
+  int ambiguous_p;
+
+  // the grammar description is the same for all calls in practice, so avoid
+  // compiling it again for every loop sequence
+  if (s_grammar == NULL || strcmp(s_description, description) != 0) {
+    if (s_grammar != NULL) {
+      yaep_free_grammar(s_grammar);
+      free(s_description);
+    }
+    s_grammar = compile_grammar(description);
+    s_description = strdup(description);
+  }
+  struct grammar *g = s_grammar;
 
   int parsed = yaep_parse(g, read_token_func, syntax_error_func,
                           parse_alloc_func, NULL, &root, &ambiguous_p);
@@ -105,7 +134,7 @@ struct hairpin {
 
 struct hairpin *initialize_new_hairpin_node() {
   struct hairpin *new_hairpin =
-      (struct hairpin *)malloc(sizeof(struct hairpin));
+      (struct hairpin *)arena_alloc(&s_arena, sizeof(struct hairpin));
   new_hairpin->start = 0;
   new_hairpin->stems = 0;
   new_hairpin->size = 0;
@@ -132,14 +161,10 @@ struct hairpin *filter_hairpin_list(struct hairpin *list, int stems, int size) {
   for (struct hairpin *h = list, *prev = NULL; h != NULL;) {
     if (h->stems < stems || h->size < size) {
       if (prev == NULL) {
-        prev = h;
         h = h->next;
-        free(prev);
-        prev = NULL;
         list = h;
       } else {
         prev->next = h->next;
-        free(h);
         h = prev->next;
       }
     } else {
@@ -521,6 +546,8 @@ void write_hairpin_trees(struct hairpin *current, struct hairpin *next,
 
     iter = iter->next;
   }
+
+  free(buf);
 }
 
 char *detect_hairpins(char *grammar, char *sequence, int min_stems,
@@ -545,7 +572,6 @@ char *detect_hairpins(char *grammar, char *sequence, int min_stems,
     struct hairpin *next = iter->next;
     if (hairpin_equal(iter, prev)) {
       prev->next = next;
-      free(iter);
     } else {
       prev = iter;
     }
@@ -558,5 +584,12 @@ char *detect_hairpins(char *grammar, char *sequence, int min_stems,
                       max_per_loop, max_bulge, min_stems);
 
   fclose(fp);
+
+  // hairpin nodes and the parse tree all live in the arena
+  arena_reset(&s_arena);
+
+  // the caller copies the result, keep it only until the next call
+  free(s_result);
+  s_result = buffer;
   return buffer;
 }
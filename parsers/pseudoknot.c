@@ -22,11 +22,20 @@
  */
 
 // standard libraries
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 // custom imports
+#include "arena.h"
+#include "bitset.h"
+#include "packed.h"
+#include "stembound.h"
 #include "hashtab.h"
 #include "objstack.h"
 #include "yaep.h"
@@ -37,15 +46,57 @@
 #define TRUE 1
 #define FALSE 0
 
-static char *s_input;
-static int s_ntok;
 static int s_max_dd_size;
 static int s_min_dd_size;
 static int s_max_window_size;
 static int s_min_window_size;
 static float s_min_window_size_ratio;
 static float s_max_window_size_ratio;
-static char *s_definition;
+static struct grammar *s_grammar;
+
+// see set_stem_bound()
+static int s_stem_bound_enabled;
+static int s_stem_bound_allow_smaller;
+static struct stem_bound_stats s_stem_bound_stats;
+
+/**
+ * Open addressing hash map from parse tree nodes to their dd sets. YAEP shares
+ * nodes between alternative parses, so this ensures that each node is only
+ * expanded once per parse. Lives in the arena, like the parse tree itself.
+ **/
+struct dd_memo {
+  int capacity; // power of two
+  int count;
+  const struct yaep_tree_node **keys;
+  uint64_t **values;
+};
+
+/**
+ * Per-scan parser state. Holds a private copy of the input sequence, so that
+ * the caller's buffer is never modified, and the token position for the
+ * window that is currently being parsed. Parse trees and the lists built from
+ * them are allocated from the arena, which is reset after every window.
+ * If the stem bound is enabled, use_bound is set and windows are checked
+ * against bound before being parsed.
+ **/
+struct parser_context {
+  char *input;
+  int ntok;
+  int min_window_size;
+  int max_window_size;
+  struct arena arena;
+  struct dd_memo *dd_memo;
+  int use_bound;
+  struct stem_bound bound;
+};
+
+// YAEP does not pass user data to read_token_func, so the active context is
+// reached through a thread-local pointer instead.
+static __thread struct parser_context *t_context;
+
+// receives (left, size, left_loop_size, dd_size) for each detected core stem
+typedef void (*emit_func)(void *data, int left, int size, int left_loop_size,
+                          int dd_size);
 
 /*************************************************************************
  *                      GRAMMAR DEFINITION                             *
@@ -57,121 +108,102 @@ static char *s_definition;
                 Struct definitions:
 **************************************************************************/
 
-struct pseudoknot {
-  int left_loop_size;
-  int dd_size;
-  struct pseudoknot *next;
-};
+/**
+ * Set of dd sizes in [0, s_max_dd_size], as a bitset of s_dd_words words.
+ **/
+typedef uint64_t *dd_set;
+
+static int s_dd_words;
 
-// struct to keep a long list of integers
-struct size {
-  int value;
-  struct size *next;
+/**
+ * Set of (left_loop_size, dd_size) pairs found in a single window. Bit
+ * (left_loop_size * (s_max_dd_size + 1) + dd_size) is set for each pair, so
+ * iterating over the set bits yields results ordered by left loop size first
+ * and dd size second.
+ **/
+struct pseudoknot_set {
+  int max_left_loop_size;
+  int words;
+  uint64_t *bits;
 };
 
 /*************************************************************************
  *                Struct management:                                      *
  **************************************************************************/
 
-struct pseudoknot *create_pseudoknot(int left_loop_size, int dd_size) {
-  struct pseudoknot *ps =
-      (struct pseudoknot *)malloc(sizeof(struct pseudoknot));
-  ps->left_loop_size = left_loop_size;
-  ps->dd_size = dd_size;
-  ps->next = NULL;
-  return ps;
-};
-
-struct size *create_size(int size) {
-  struct size *size_node = (struct size *)malloc(sizeof(struct size));
-  size_node->value = size;
-  size_node->next = NULL;
-  return size_node;
-};
+static void *context_alloc(size_t size) {
+  return arena_alloc(&t_context->arena, size);
+}
 
-struct pseudoknot *
-append_pseudoknot_if_not_exists(struct pseudoknot *list,
-                                struct pseudoknot *upcoming_knot) {
-  // FIXME: this is more like an assertion and may be removed
-  // if (upcoming_knot->left_loop_size<1){
-  //     return list;
-  // }
-
-  // TODO(akolaitis): This currently iterates over the whole list when
-  // inserting a new pseudoknot, making insert an O(n) operation, and
-  // the list creation an O(n^2) in total. We can do much better than
-  // that.
-  for (struct pseudoknot *it = list; it != NULL; it = it->next) {
-    if (it->left_loop_size == upcoming_knot->left_loop_size &&
-        it->dd_size == upcoming_knot->dd_size) {
-      // printf(" -- skipping size: %d, upcoming dd %d \n",
-      // upcoming_knot->left_loop_size, upcoming_knot->dd_size);
-      return list;
-    }
-  }
-  // printf(" -- Upcoming size: %d, upcoming dd %d \n",
-  // upcoming_knot->left_loop_size, upcoming_knot->dd_size);
-  upcoming_knot->next = list;
-  return upcoming_knot;
+dd_set create_dd_set() {
+  dd_set set = (dd_set)context_alloc(s_dd_words * sizeof(uint64_t));
+  bitset_clear(set, s_dd_words);
+  return set;
 }
 
-struct size *append_size_if_not_exists(struct size *list, int size) {
-  struct size *size_node;
-  struct size *iter = list;
+struct dd_memo *create_dd_memo(int capacity) {
+  struct dd_memo *memo = context_alloc(sizeof(struct dd_memo));
+  memo->capacity = capacity;
+  memo->count = 0;
+  memo->keys = context_alloc(capacity * sizeof(*memo->keys));
+  memo->values = context_alloc(capacity * sizeof(*memo->values));
+  memset(memo->keys, 0, capacity * sizeof(*memo->keys));
+  return memo;
+}
 
-  while (iter != NULL) {
-    if (iter->value == size) {
-      return list;
-    }
-    iter = iter->next;
+static int dd_memo_slot(struct dd_memo *memo,
+                        const struct yaep_tree_node *node) {
+  uint64_t h = ((uintptr_t)node >> 4) * 0x9E3779B97F4A7C15ULL;
+  int i = (h >> 32) & (memo->capacity - 1);
+  while (memo->keys[i] != NULL && memo->keys[i] != node) {
+    i = (i + 1) & (memo->capacity - 1);
   }
-  size_node = create_size(size);
-  size_node->next = list;
-  return size_node;
+  return i;
 }
 
-/**
- * concatenate two lists into one, this is a cut
- * meaning that elements are going to be maintained uniquely
- **/
-struct pseudoknot *concatenate_punique(struct pseudoknot *list1,
-                                       struct pseudoknot *list2) {
-  struct pseudoknot *iter2 = list2, *next = NULL;
-  struct pseudoknot *new_list_head = list1;
-
-  if (list1 == NULL) {
-    return list2;
-  }
-  if (list2 == NULL) {
-    return list1;
-  }
+dd_set dd_memo_get(struct dd_memo *memo, const struct yaep_tree_node *node) {
+  int i = dd_memo_slot(memo, node);
+  return memo->keys[i] == node ? memo->values[i] : NULL;
+}
 
-  while (iter2 != NULL) {
-    next = iter2->next;
-    new_list_head = append_pseudoknot_if_not_exists(new_list_head, iter2);
-    iter2 = next;
+void dd_memo_put(const struct yaep_tree_node *node, dd_set sizes) {
+  struct dd_memo *memo = t_context->dd_memo;
+
+  // keep load factor below 1/2, old table is released with the arena
+  if (2 * (memo->count + 1) > memo->capacity) {
+    struct dd_memo *grown = create_dd_memo(2 * memo->capacity);
+    for (int i = 0; i < memo->capacity; i++) {
+      if (memo->keys[i] != NULL) {
+        int j = dd_memo_slot(grown, memo->keys[i]);
+        grown->keys[j] = memo->keys[i];
+        grown->values[j] = memo->values[i];
+      }
+    }
+    grown->count = memo->count;
+    memo = t_context->dd_memo = grown;
   }
 
-  return new_list_head;
+  int i = dd_memo_slot(memo, node);
+  memo->keys[i] = node;
+  memo->values[i] = sizes;
+  memo->count++;
 }
 
-struct size *concatenate_sunique(struct size *list1, struct size *list2) {
-  struct size *iter2 = list2;
-  struct size *new_list_head = list1;
-
-  if (list1 == NULL) {
-    return list2;
-  }
-  if (list2 == NULL) {
-    return list1;
-  }
-  while (iter2 != NULL) {
-    new_list_head = append_size_if_not_exists(new_list_head, iter2->value);
+void init_pseudoknot_set(struct pseudoknot_set *set, int max_left_loop_size) {
+  int nbits = (max_left_loop_size + 1) * (s_max_dd_size + 1);
+  set->max_left_loop_size = max_left_loop_size;
+  set->words = BITSET_WORDS(nbits);
+  set->bits = (uint64_t *)context_alloc(set->words * sizeof(uint64_t));
+  bitset_clear(set->bits, set->words);
+}
 
-    iter2 = iter2->next;
+void add_pseudoknot(struct pseudoknot_set *set, int left_loop_size,
+                    int dd_size) {
+  // FIXME: this is more like an assertion and may be removed
+  if (left_loop_size < 0 || left_loop_size > set->max_left_loop_size) {
+    return;
   }
-
-  return new_list_head;
+  bitset_set(set->bits, left_loop_size * (s_max_dd_size + 1) + dd_size);
 }
 
 /************************************************************************
@@ -208,8 +240,8 @@ void print_node_type(struct yaep_tree_node *node) {
 
 static int read_token_func(void **attr) {
   *attr = NULL;
-  if (s_input[s_ntok]) {
-    return s_input[s_ntok++];
+  if (t_context->input[t_context->ntok]) {
+    return t_context->input[t_context->ntok++];
   } else {
     return -1;
   }
@@ -232,16 +264,15 @@ static void syntax_error_func(int err_tok_num, void *err_tok_attr,
   }
 }
 
-static void *parse_alloc_func(int size) {
-  void *result;
-  result = malloc(size);
-  return result;
-}
+static void *parse_alloc_func(int size) { return context_alloc(size); }
 
-struct yaep_tree_node *parse(const char *description) {
+/**
+ * Compile the grammar description into a YAEP grammar. This is expensive
+ * (grammar analysis and lookahead tables), so it should only be done once
+ * and the resulting grammar reused for every parse.
+ **/
+static struct grammar *compile_grammar(const char *description) {
   struct grammar *g;
-  struct yaep_tree_node *root;
-  int ambiguous_p;
 
   if ((g = yaep_create_grammar()) == NULL) {
     fprintf(stderr, "yaep_create_grammar: No memory\n");
@@ -255,6 +286,13 @@ struct yaep_tree_node *parse(const char *description) {
     fprintf(stderr, "%s\n", yaep_error_message(g));
     exit(1);
   }
+  return g;
+}
+
+struct yaep_tree_node *parse(struct grammar *g) {
+  struct yaep_tree_node *root;
+  int ambiguous_p;
+
   int parsed = yaep_parse(g, read_token_func, syntax_error_func,
                           parse_alloc_func, NULL, &root, &ambiguous_p);
   if (parsed) {
@@ -301,49 +339,50 @@ int traverse_parse_tree_for_loop(struct yaep_tree_node *node) {
   }
 }
 
-// (akolaitis) debugging
-void dump(struct size *s) {
-  for (struct size *a = s; a != NULL; a = a->next) {
-    printf("%d ->", a->value);
+// return {a + b for a in A, b in B}
+dd_set cartesianProduct(dd_set A, dd_set B) {
+  dd_set sizes = create_dd_set();
+  for (int a = bitset_next(A, s_dd_words, 0); a >= 0;
+       a = bitset_next(A, s_dd_words, a + 1)) {
+    bitset_or_shifted(sizes, B, s_dd_words, a);
   }
-  printf("\n");
+  return sizes;
 }
 
-// return [A x B]
-struct size *cartesianProduct(struct size *A, struct size *B) {
-  struct size *sizes = NULL;
-  if (A == NULL)
-    return B;
-  if (B == NULL)
-    return A;
-  // printf("iterA:"); dump(A);
-  // printf("iterB:"); dump(B);
-  for (struct size *iterA = A; iterA != NULL; iterA = iterA->next) {
-    for (struct size *iterB = B; iterB != NULL; iterB = iterB->next) {
-      sizes = append_size_if_not_exists(sizes, iterA->value + iterB->value);
+// [A[0] x A[1] x ... x A[count-1]], empty sets are skipped
+dd_set multiCartesianProduct(dd_set *A, int count) {
+  dd_set sizes = NULL;
+  for (int i = 0; i < count; i++) {
+    if (bitset_empty(A[i], s_dd_words)) {
+      continue;
     }
+    sizes = sizes == NULL ? A[i] : cartesianProduct(sizes, A[i]);
   }
-  // printf("result:"); dump(sizes);
-  return sizes;
+  return sizes == NULL ? create_dd_set() : sizes;
 }
 
-// [A[0] x A[1] x ... x A[count-1]]
-struct size *multiCartesianProduct(struct size **A, int count) {
-  struct size *sizes = NULL;
-  for (int i = 0; i < count; i++) {
-    sizes = cartesianProduct(sizes, A[i]);
+dd_set expand_parse_tree_for_dd(struct yaep_tree_node *node);
+
+/**
+ * Returns the set of all the dd size variations of a particular R rule.
+ * Returned sets are shared between callers and must not be modified.
+ **/
+dd_set traverse_parse_tree_for_dd(struct yaep_tree_node *node) {
+  dd_set sizes = dd_memo_get(t_context->dd_memo, node);
+  if (sizes == NULL) {
+    sizes = expand_parse_tree_for_dd(node);
+    dd_memo_put(node, sizes);
   }
   return sizes;
 }
 
-/**
- * Returns a list of all the dd size variations of a particular R rule
- **/
-struct size *traverse_parse_tree_for_dd(struct yaep_tree_node *node) {
+dd_set expand_parse_tree_for_dd(struct yaep_tree_node *node) {
+  dd_set sizes;
+
   switch (node->type) {
   case YAEP_ANODE:
     if ((node->val.anode.name)[0] == 'M') {
-      struct size **childSizes = malloc(s_max_dd_size * sizeof(struct size *));
+      dd_set *childSizes = context_alloc(s_max_dd_size * sizeof(dd_set));
       for (int i = 0; i < s_max_dd_size; i++) {
         childSizes[i] = traverse_parse_tree_for_dd(node->val.anode.children[i]);
       }
@@ -353,122 +392,537 @@ struct size *traverse_parse_tree_for_dd(struct yaep_tree_node *node) {
     }
     break;
   case YAEP_TERM:
-    return create_size(1); // should return a size node of value 1
-    break;
+    sizes = create_dd_set();
+    bitset_set(sizes, 1);
+    return sizes;
   case YAEP_NIL:
-    return create_size(0); // should return NULL node
-    break;
-  case YAEP_ALT:;
-    struct size *anode_dds = traverse_parse_tree_for_dd(node->val.alt.node);
-    struct size *alt_dds = NULL;
+    sizes = create_dd_set();
+    bitset_set(sizes, 0);
+    return sizes;
+  case YAEP_ALT:
+    sizes = create_dd_set();
+    bitset_or(sizes, traverse_parse_tree_for_dd(node->val.alt.node),
+              s_dd_words);
     if (node->val.alt.next != NULL) {
-      alt_dds = traverse_parse_tree_for_dd(node->val.alt.next);
+      bitset_or(sizes, traverse_parse_tree_for_dd(node->val.alt.next),
+                s_dd_words);
     }
-    struct size *new_list = concatenate_sunique(anode_dds, alt_dds);
-    return new_list;
-    break;
+    return sizes;
   default:
     printf("I think something went really wrong with node type \n");
   }
-  return NULL;
+  return create_dd_set();
 }
 
 /**
  * Traverses the high level graph in the means of alternative R rules and only.
- * Returns a list of all identified pesudoknots.
+ * Adds all identified pseudoknots to the set.
  **/
-struct pseudoknot *traverse_parse_tree(struct yaep_tree_node *node) {
+void traverse_parse_tree(struct yaep_tree_node *node,
+                         struct pseudoknot_set *pseudoknots) {
   int loop_size;
-  struct size *dd_sizes;
-  struct pseudoknot *pknots = NULL;
-  struct pseudoknot *pseudoknots = NULL;
+  dd_set dd_sizes;
   if (!node) {
-    return pseudoknots;
+    return;
   }
   switch (node->type) {
   case YAEP_ERROR:
-    return NULL;
   case YAEP_NIL:
-    return NULL;
   case YAEP_TERM:
-    return NULL;
+    return;
   case YAEP_ANODE:
     if ((node->val.anode.name)[0] != 'R') {
       // This should never resolve ...
-      return NULL;
+      return;
     }
     loop_size = traverse_parse_tree_for_loop(node->val.anode.children[0]);
     dd_sizes = traverse_parse_tree_for_dd(node->val.anode.children[1]);
 
-    while (dd_sizes != NULL) {
-      pseudoknots = append_pseudoknot_if_not_exists(
-          pseudoknots, create_pseudoknot(loop_size, dd_sizes->value));
-      dd_sizes = dd_sizes->next;
+    for (int dd = bitset_next(dd_sizes, s_dd_words, 0); dd >= 0;
+         dd = bitset_next(dd_sizes, s_dd_words, dd + 1)) {
+      add_pseudoknot(pseudoknots, loop_size, dd);
     }
-    return pseudoknots;
+    return;
   case YAEP_ALT:
-    pknots = traverse_parse_tree(
-        node->val.alt.node); // the list comming from the anode
+    // the set comming from the anode
+    traverse_parse_tree(node->val.alt.node, pseudoknots);
 
-    // a list comming from the alterantive node, in case it exists
-    pseudoknots = NULL;
+    // the set comming from the alterantive node, in case it exists
     if (node->val.alt.next != NULL) {
-      pseudoknots = traverse_parse_tree(node->val.alt.next);
-      // print_node_type(node->val.alt.next);
+      traverse_parse_tree(node->val.alt.next, pseudoknots);
     }
-
-    pseudoknots = concatenate_punique(pseudoknots, pknots);
-    return pseudoknots;
+    return;
   default:
     printf("I don't give a shit! \n");
-    return pseudoknots;
+    return;
   }
 }
 
-void detect_pseudoknots(char *sequence, void (*cb)(int, int, int, int)) {
-  s_input = sequence;
+/************************************************************************
+ *                           Window scanning                             *
+ *************************************************************************/
 
+void init_context(struct parser_context *ctx, const char *sequence) {
   int len = strlen(sequence);
 
-  // The loop variables ensure that in every outer iteration we can discard the
-  // last character of the input string.
+  ctx->input = strdup(sequence);
+  ctx->ntok = 0;
+  ctx->arena.head = NULL;
 
   // window size is static or ratio of sequence length
-  int min_window_size =
+  ctx->min_window_size =
       s_min_window_size ? s_min_window_size : (len * s_min_window_size_ratio);
-  int max_window_size =
+  ctx->max_window_size =
       s_max_window_size ? s_max_window_size : (len * s_max_window_size_ratio);
 
-  // output format is
-  // start,length:leftloopsize,ddsize|leftloopsize2,ddsize2
-  for (int right = len - 1; right >= min_window_size - 1; right--) {
-    for (int left = right - min_window_size + 1;
-         left > right - max_window_size && left >= 0; left--) {
-      s_ntok = left;
-      struct yaep_tree_node *root = parse(s_definition);
-      struct pseudoknot *ps = traverse_parse_tree(root);
-
-      for (struct pseudoknot *i = ps; i != NULL; i = i->next) {
-        if (i->dd_size < s_min_dd_size) {
+  ctx->use_bound = s_stem_bound_enabled;
+  if (ctx->use_bound) {
+    stem_bound_init(&ctx->bound, packed_sequence_get(sequence),
+                    s_stem_bound_allow_smaller, &s_stem_bound_stats);
+  }
+}
+
+void free_context(struct parser_context *ctx) {
+  free(ctx->input);
+  arena_free(&ctx->arena);
+  if (ctx->use_bound) {
+    stem_bound_free(&ctx->bound);
+  }
+}
+
+/**
+ * Parse all windows ending in [right_lo, right_hi], with `right` descending.
+ * Expects that ctx->input is terminated right after right_hi.
+ **/
+void scan_windows(struct parser_context *ctx, int right_lo, int right_hi,
+                  emit_func emit, void *data) {
+  t_context = ctx;
+
+  // The loop variables ensure that in every outer iteration we can discard the
+  // last character of the input string.
+  for (int right = right_hi; right >= right_lo; right--) {
+    for (int left = right - ctx->min_window_size + 1;
+         left > right - ctx->max_window_size && left >= 0; left--) {
+      if (ctx->use_bound && stem_bound_skip_window(&ctx->bound, left, right)) {
+        continue;
+      }
+
+      ctx->ntok = left;
+      struct yaep_tree_node *root = parse(s_grammar);
+
+      struct pseudoknot_set ps;
+      init_pseudoknot_set(&ps, right - left + 1);
+      ctx->dd_memo = create_dd_memo(64);
+      traverse_parse_tree(root, &ps);
+
+      for (int i = bitset_next(ps.bits, ps.words, 0); i >= 0;
+           i = bitset_next(ps.bits, ps.words, i + 1)) {
+        int left_loop_size = i / (s_max_dd_size + 1);
+        int dd_size = i % (s_max_dd_size + 1);
+        if (dd_size < s_min_dd_size) {
+          continue;
+        }
+        if (ctx->use_bound &&
+            stem_bound_skip_core_stem(&ctx->bound, left, right - left + 1,
+                                      left_loop_size, dd_size)) {
           continue;
         }
-        cb(left, right - left + 1, i->left_loop_size, i->dd_size);
-        // fprintf(fp, "%d,%d,%d,%d\n", left, right - left + 1,
-        // i->left_loop_size, i->dd_size);
+        emit(data, left, right - left + 1, left_loop_size, dd_size);
       }
+
+      // parse tree and results are not needed after this point
+      arena_reset(&ctx->arena);
     }
 
     // we finished all windows where the last character is used, now discard
-    s_input[right] = '\0';
+    ctx->input[right] = '\0';
   }
+
+  t_context = NULL;
+}
+
+static void emit_to_callback(void *data, int left, int size,
+                             int left_loop_size, int dd_size) {
+  void (*cb)(int, int, int, int) = (void (*)(int, int, int, int))data;
+  cb(left, size, left_loop_size, dd_size);
+}
+
+static void emit_to_packed(void *data, int left, int size, int left_loop_size,
+                           int dd_size) {
+  int32_t *row = packed_rows_push((struct packed_rows *)data);
+  row[0] = left;
+  row[1] = size;
+  row[2] = left_loop_size;
+  row[3] = dd_size;
+}
+
+static void scan(const char *sequence, emit_func emit, void *data) {
+  struct parser_context ctx;
+  init_context(&ctx, sequence);
+
+  // output format is
+  // start,length:leftloopsize,ddsize|leftloopsize2,ddsize2
+  int right_lo = ctx.min_window_size - 1 < 0 ? 0 : ctx.min_window_size - 1;
+  scan_windows(&ctx, right_lo, strlen(sequence) - 1, emit, data);
+
+  free_context(&ctx);
+}
+
+void detect_pseudoknots(char *sequence, void (*cb)(int, int, int, int)) {
+  scan(sequence, emit_to_callback, (void *)cb);
+}
+
+/**
+ * Same as detect_pseudoknots(), but return all results at once, as *count
+ * rows of (left, size, left_loop_size, dd_size). Release with packed_free().
+ **/
+int32_t *detect_pseudoknots_packed(char *sequence, int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  scan(sequence, emit_to_packed, &rows);
+  return packed_rows_release(&rows, count);
+}
+
+/**
+ * Run detect_pseudoknots_packed() for n sequences at once. The rows of the
+ * k-th sequence are rows [offsets[k], offsets[k + 1]) of the returned buffer,
+ * so offsets must have room for n + 1 values. Release with packed_free().
+ **/
+int32_t *detect_pseudoknots_batch(const char **sequences, int n,
+                                  int32_t *count, int32_t *offsets) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  for (int k = 0; k < n; k++) {
+    offsets[k] = rows.count;
+    scan(sequences[k], emit_to_packed, &rows);
+  }
+  offsets[n] = rows.count;
+  return packed_rows_release(&rows, count);
+}
+
+void packed_free(void *data) { free(data); }
+
+/************************************************************************
+ *                        Parallel window scanning                       *
+ *************************************************************************/
+
+/*
+  YAEP keeps the state of the parse in globals, so two parses can never run
+  concurrently in the same address space, not even with separate grammars.
+  Instead, detect_pseudoknots_parallel() forks one worker process per chunk
+  of `right` values. Each worker scans its chunk and streams its results back
+  through a pipe as (left, size, left_loop_size, dd_size) int records. The
+  parent drains all pipes as they fill up, and then calls cb for every chunk
+  in order, so results are reported in exactly the same order as
+  detect_pseudoknots().
+
+  If a worker cannot be started or does not exit cleanly, its chunk is
+  scanned again in the calling process.
+
+  With the stem bound enabled, each worker starts from an empty bound, so
+  fewer windows are skipped than with detect_pseudoknots(). Stem bound
+  statistics only count windows scanned in the calling process.
+*/
+
+#define RECORD_INTS 4
+#define WORKER_BUFFER_RECORDS 4096
+
+struct chunk {
+  int right_lo, right_hi;
+  pid_t pid;
+  int fd;
+  char *data;
+  size_t size, capacity;
+};
+
+struct record_buffer {
+  int fd; // if >= 0, flush records to this file descriptor when full
+  int *data;
+  size_t count, capacity;
+};
+
+static int write_all(int fd, const void *buf, size_t size) {
+  const char *p = buf;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    p += n;
+    size -= n;
+  }
+  return 0;
+}
+
+static void flush_records(struct record_buffer *buf) {
+  if (write_all(buf->fd, buf->data, buf->count * RECORD_INTS * sizeof(int))) {
+    _exit(1);
+  }
+  buf->count = 0;
+}
+
+static void emit_to_buffer(void *data, int left, int size, int left_loop_size,
+                           int dd_size) {
+  struct record_buffer *buf = data;
+  if (buf->count == buf->capacity) {
+    if (buf->fd >= 0) {
+      flush_records(buf);
+    } else {
+      buf->capacity = buf->capacity ? 2 * buf->capacity : WORKER_BUFFER_RECORDS;
+      buf->data =
+          realloc(buf->data, buf->capacity * RECORD_INTS * sizeof(int));
+    }
+  }
+  int *record = buf->data + buf->count * RECORD_INTS;
+  record[0] = left;
+  record[1] = size;
+  record[2] = left_loop_size;
+  record[3] = dd_size;
+  buf->count++;
+}
+
+/**
+ * Split [right_lo, right_hi] into n contiguous chunks of roughly equal
+ * parsing cost. Cost of each window is estimated by its size.
+ **/
+static void split_chunks(struct parser_context *ctx, int right_lo,
+                         int right_hi, struct chunk *chunks, int n) {
+  double total = 0;
+  double *cost = calloc(right_hi - right_lo + 1, sizeof(double));
+  for (int right = right_hi; right >= right_lo; right--) {
+    for (int left = right - ctx->min_window_size + 1;
+         left > right - ctx->max_window_size && left >= 0; left--) {
+      cost[right - right_lo] += right - left + 1;
+    }
+    total += cost[right - right_lo];
+  }
+
+  int right = right_hi;
+  double seen = 0;
+  for (int i = 0; i < n; i++) {
+    chunks[i].right_hi = right;
+    // take at least one right, and leave one for each of the remaining chunks
+    do {
+      seen += cost[right - right_lo];
+      right--;
+    } while (right - right_lo >= n - i - 1 &&
+             (i == n - 1 || seen < total * (i + 1) / n));
+    chunks[i].right_lo = right + 1;
+  }
+  free(cost);
+}
+
+static void start_worker(struct parser_context *ctx, struct chunk *chunk) {
+  int fds[2];
+
+  chunk->pid = -1;
+  chunk->fd = -1;
+  if (pipe(fds) != 0) {
+    return;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  }
+
+  if (pid == 0) {
+    close(fds[0]);
+    struct record_buffer buf = {fds[1], NULL, 0, WORKER_BUFFER_RECORDS};
+    buf.data = malloc(buf.capacity * RECORD_INTS * sizeof(int));
+
+    ctx->input[chunk->right_hi + 1] = '\0';
+    scan_windows(ctx, chunk->right_lo, chunk->right_hi, emit_to_buffer, &buf);
+    flush_records(&buf);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  chunk->pid = pid;
+  chunk->fd = fds[0];
+}
+
+/**
+ * Read all available data from the workers, until every pipe is closed.
+ **/
+static void drain_workers(struct chunk *chunks, int n) {
+  struct pollfd *pfds = malloc(n * sizeof(struct pollfd));
+  char buf[65536];
+
+  for (;;) {
+    int npfds = 0;
+    for (int i = 0; i < n; i++) {
+      if (chunks[i].fd >= 0) {
+        pfds[npfds].fd = chunks[i].fd;
+        pfds[npfds].events = POLLIN;
+        pfds[npfds].revents = 0;
+        npfds++;
+      }
+    }
+    if (npfds == 0) {
+      break;
+    }
+
+    if (poll(pfds, npfds, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    for (int i = 0, p = 0; i < n; i++) {
+      if (chunks[i].fd < 0) {
+        continue;
+      }
+      short revents = pfds[p++].revents;
+      if (!revents) {
+        continue;
+      }
+
+      ssize_t nread = read(chunks[i].fd, buf, sizeof(buf));
+      if (nread < 0 && errno == EINTR) {
+        continue;
+      }
+      if (nread <= 0) {
+        close(chunks[i].fd);
+        chunks[i].fd = -1;
+        continue;
+      }
+
+      if (chunks[i].size + nread > chunks[i].capacity) {
+        chunks[i].capacity = 2 * (chunks[i].size + nread);
+        chunks[i].data = realloc(chunks[i].data, chunks[i].capacity);
+      }
+      memcpy(chunks[i].data + chunks[i].size, buf, nread);
+      chunks[i].size += nread;
+    }
+  }
+
+  // if poll failed, results of the remaining workers are incomplete
+  for (int i = 0; i < n; i++) {
+    if (chunks[i].fd >= 0) {
+      close(chunks[i].fd);
+      chunks[i].fd = -1;
+    }
+  }
+  free(pfds);
+}
+
+static void scan_parallel(char *sequence, int nthreads, emit_func emit,
+                          void *data) {
+  struct parser_context ctx;
+  init_context(&ctx, sequence);
+
+  int right_lo = ctx.min_window_size - 1 < 0 ? 0 : ctx.min_window_size - 1;
+  int right_hi = strlen(sequence) - 1;
+  if (nthreads > right_hi - right_lo + 1) {
+    nthreads = right_hi - right_lo + 1;
+  }
+  if (nthreads <= 1) {
+    free_context(&ctx);
+    scan(sequence, emit, data);
+    return;
+  }
+
+  struct chunk *chunks = calloc(nthreads, sizeof(struct chunk));
+  split_chunks(&ctx, right_lo, right_hi, chunks, nthreads);
+  for (int i = 0; i < nthreads; i++) {
+    start_worker(&ctx, &chunks[i]);
+  }
+
+  drain_workers(chunks, nthreads);
+
+  for (int i = 0; i < nthreads; i++) {
+    struct chunk *chunk = &chunks[i];
+    int status = 0;
+    int ok = chunk->pid > 0;
+    if (ok) {
+      while (waitpid(chunk->pid, &status, 0) < 0 && errno == EINTR)
+        ;
+      ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+           chunk->size % (RECORD_INTS * sizeof(int)) == 0;
+    }
+
+    int *records = (int *)chunk->data;
+    size_t count = chunk->size / (RECORD_INTS * sizeof(int));
+    struct record_buffer buf = {-1, NULL, 0, 0};
+    if (!ok) {
+      // worker failed, scan the chunk in this process
+      strcpy(ctx.input, sequence);
+      ctx.input[chunk->right_hi + 1] = '\0';
+      scan_windows(&ctx, chunk->right_lo, chunk->right_hi, emit_to_buffer,
+                   &buf);
+      records = buf.data;
+      count = buf.count;
+    }
+
+    for (size_t r = 0; r < count; r++) {
+      int *record = records + r * RECORD_INTS;
+      emit(data, record[0], record[1], record[2], record[3]);
+    }
+
+    free(buf.data);
+    free(chunk->data);
+  }
+
+  free(chunks);
+  free_context(&ctx);
+}
+
+void detect_pseudoknots_parallel(char *sequence, int nthreads,
+                                 void (*cb)(int, int, int, int)) {
+  scan_parallel(sequence, nthreads, emit_to_callback, (void *)cb);
+}
+
+int32_t *detect_pseudoknots_parallel_packed(char *sequence, int nthreads,
+                                            int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  scan_parallel(sequence, nthreads, emit_to_packed, &rows);
+  return packed_rows_release(&rows, count);
+}
+
+/**
+ * Enable or disable the stem bound (see stembound.h). With the bound enabled,
+ * windows and core stems that would be discarded by prune_early with the same
+ * max_stem_allow_smaller are not reported. Also resets the statistics.
+ **/
+void set_stem_bound(int enabled, int max_stem_allow_smaller) {
+  s_stem_bound_enabled = enabled;
+  s_stem_bound_allow_smaller = max_stem_allow_smaller;
+  memset(&s_stem_bound_stats, 0, sizeof(s_stem_bound_stats));
+}
+
+/**
+ * Store the number of windows, skipped windows, core stems and skipped core
+ * stems since the last call to set_stem_bound() in stats[0..3].
+ **/
+void get_stem_bound_stats(int64_t *stats) {
+  stats[0] = s_stem_bound_stats.windows;
+  stats[1] = s_stem_bound_stats.windows_skipped;
+  stats[2] = s_stem_bound_stats.core_stems;
+  stats[3] = s_stem_bound_stats.core_stems_skipped;
 }
 
 void initialize(char *_grammar, int _allow_ug, int _min_dd_size,
                 int _max_dd_size, int _min_window_size, int _max_window_size,
                 float _min_window_size_ratio, float _max_window_size_ratio) {
-  s_definition = strdup(_grammar);
+  // compile grammar once, all windows are parsed with the same grammar
+  if (s_grammar != NULL) {
+    yaep_free_grammar(s_grammar);
+  }
+  s_grammar = compile_grammar(_grammar);
+
   s_min_dd_size = _min_dd_size;
   s_max_dd_size = _max_dd_size;
+  s_dd_words = BITSET_WORDS(s_max_dd_size + 1);
   s_min_window_size = _min_window_size;
   s_max_window_size = _max_window_size;
   s_min_window_size_ratio = _min_window_size_ratio;
@@ -0,0 +1,231 @@
+/*
+ * Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+ *                  Evangelos Makris, Aggelos Kolaitis
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Description: Single-pass recognizer for detecting positions of core stems
+// of pseudoknot in an RNA sequence. Produces the same windows and core stems
+// as the YAEP grammar in pseudoknot.c, without running an Earley parse for
+// every window.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packed.h"
+#include "sequence.h"
+#include "stembound.h"
+
+// receives (left, size, left_loop_size, dd_size) for each detected core stem
+typedef void (*emit_func)(void *data, int left, int size, int left_loop_size,
+                          int dd_size);
+
+static int s_allow_ug;
+static int s_min_dd_size;
+static int s_max_dd_size;
+static int s_min_window_size;
+static int s_max_window_size;
+static float s_min_window_size_ratio;
+static float s_max_window_size_ratio;
+
+// see set_stem_bound()
+static int s_stem_bound_enabled;
+static int s_stem_bound_allow_smaller;
+static struct stem_bound_stats s_stem_bound_stats;
+
+void initialize(char *_options_unused, int _allow_ug, int _min_dd_size,
+                int _max_dd_size, int _min_window_size, int _max_window_size,
+                float _min_window_size_ratio, float _max_window_size_ratio) {
+  (void)_options_unused;
+  s_allow_ug = _allow_ug;
+  s_min_dd_size = _min_dd_size;
+  s_max_dd_size = _max_dd_size;
+  s_min_window_size = _min_window_size;
+  s_max_window_size = _max_window_size;
+  s_min_window_size_ratio = _min_window_size_ratio;
+  s_max_window_size_ratio = _max_window_size_ratio;
+}
+
+/*
+  A window [left, right] contains a core stem when:
+
+  BRACKET  = (......[....)......]
+  NOTATION = L......R....l......r
+
+  L = left, r = right
+  L pairs with l, R pairs with r
+  R - L - 1 >= 1                          -- left loop is not empty
+  min_dd_size <= l - R - 1 <= max_dd_size -- dd size
+  r - l - 1 >= 1                          -- right loop is not empty
+
+  All windows ending at `right` share the candidates for R, so these are
+  collected once per `right` instead of once per window. For each window,
+  only the candidates R >= left + 2 are checked, along with the (at most
+  max_dd_size + 1) candidates for l.
+
+  Windows are visited in the same order as pseudoknot.c. Inside a window,
+  results are ordered by left loop size, then by dd size.
+
+  With the stem bound enabled, windows and core stems are checked against
+  it in the same way as pseudoknot.c, so both report the same results.
+*/
+static void scan(const char *sequence, emit_func emit, void *data) {
+  const struct packed_sequence *ps = packed_sequence_get(sequence);
+  const struct pair_table *pairs = pair_table_get(s_allow_ug);
+  int len = ps->len;
+
+  // window size is static or ratio of sequence length
+  int min_window_size =
+      s_min_window_size ? s_min_window_size : (len * s_min_window_size_ratio);
+  int max_window_size =
+      s_max_window_size ? s_max_window_size : (len * s_max_window_size_ratio);
+
+  // positions R (ascending) that pair with the last character of the window
+  int *partners = (int *)malloc((len + 1) * sizeof(int));
+  uint64_t *mask = (uint64_t *)malloc((ps->words + 1) * sizeof(uint64_t));
+
+  struct stem_bound bound;
+  if (s_stem_bound_enabled) {
+    stem_bound_init(&bound, ps, s_stem_bound_allow_smaller,
+                    &s_stem_bound_stats);
+  }
+
+  for (int right = len - 1; right >= min_window_size - 1; right--) {
+    int n_partners = 0;
+    if (packed_sequence_valid(ps, right)) {
+      packed_sequence_partners(ps, pairs, packed_sequence_at(ps, right), mask);
+      for (int R = bitset_next(mask, ps->words, 0); R >= 0 && R <= right - 3;
+           R = bitset_next(mask, ps->words, R + 1)) {
+        partners[n_partners++] = R;
+      }
+    }
+
+    // partners[first:] are the candidates with R >= left + 2. since left is
+    // decreasing, first only ever moves backwards.
+    int first = n_partners;
+    for (int left = right - min_window_size + 1;
+         left > right - max_window_size && left >= 0; left--) {
+      while (first > 0 && partners[first - 1] >= left + 2) {
+        first--;
+      }
+      if (s_stem_bound_enabled && stem_bound_skip_window(&bound, left, right)) {
+        continue;
+      }
+
+      for (int p = first; p < n_partners; p++) {
+        int R = partners[p];
+        for (int dd = s_min_dd_size; dd <= s_max_dd_size; dd++) {
+          int l = R + dd + 1;
+          if (l > right - 2) {
+            break;
+          }
+          if (!packed_sequence_pairs(ps, pairs, left, l)) {
+            continue;
+          }
+          if (s_stem_bound_enabled &&
+              stem_bound_skip_core_stem(&bound, left, right - left + 1,
+                                        R - left - 1, dd)) {
+            continue;
+          }
+          emit(data, left, right - left + 1, R - left - 1, dd);
+        }
+      }
+    }
+  }
+
+  free(partners);
+  free(mask);
+  if (s_stem_bound_enabled) {
+    stem_bound_free(&bound);
+  }
+}
+
+static void emit_to_callback(void *data, int left, int size,
+                             int left_loop_size, int dd_size) {
+  void (*cb)(int, int, int, int) = (void (*)(int, int, int, int))data;
+  cb(left, size, left_loop_size, dd_size);
+}
+
+static void emit_to_packed(void *data, int left, int size, int left_loop_size,
+                           int dd_size) {
+  int32_t *row = packed_rows_push((struct packed_rows *)data);
+  row[0] = left;
+  row[1] = size;
+  row[2] = left_loop_size;
+  row[3] = dd_size;
+}
+
+void detect_pseudoknots(char *sequence, void (*cb)(int, int, int, int)) {
+  scan(sequence, emit_to_callback, (void *)cb);
+}
+
+/**
+ * Same as detect_pseudoknots(), but return all results at once, as *count
+ * rows of (left, size, left_loop_size, dd_size). Release with packed_free().
+ **/
+int32_t *detect_pseudoknots_packed(char *sequence, int32_t *count) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  scan(sequence, emit_to_packed, &rows);
+  return packed_rows_release(&rows, count);
+}
+
+/**
+ * Run detect_pseudoknots_packed() for n sequences at once. The rows of the
+ * k-th sequence are rows [offsets[k], offsets[k + 1]) of the returned buffer,
+ * so offsets must have room for n + 1 values. Release with packed_free().
+ **/
+int32_t *detect_pseudoknots_batch(const char **sequences, int n,
+                                  int32_t *count, int32_t *offsets) {
+  struct packed_rows rows;
+  packed_rows_init(&rows, 4);
+  for (int k = 0; k < n; k++) {
+    offsets[k] = rows.count;
+    scan(sequences[k], emit_to_packed, &rows);
+  }
+  offsets[n] = rows.count;
+  return packed_rows_release(&rows, count);
+}
+
+void packed_free(void *data) { free(data); }
+
+/**
+ * Enable or disable the stem bound (see stembound.h). With the bound enabled,
+ * windows and core stems that would be discarded by prune_early with the same
+ * max_stem_allow_smaller are not reported. Also resets the statistics.
+ **/
+void set_stem_bound(int enabled, int max_stem_allow_smaller) {
+  s_stem_bound_enabled = enabled;
+  s_stem_bound_allow_smaller = max_stem_allow_smaller;
+  memset(&s_stem_bound_stats, 0, sizeof(s_stem_bound_stats));
+}
+
+/**
+ * Store the number of windows, skipped windows, core stems and skipped core
+ * stems since the last call to set_stem_bound() in stats[0..3].
+ **/
+void get_stem_bound_stats(int64_t *stats) {
+  stats[0] = s_stem_bound_stats.windows;
+  stats[1] = s_stem_bound_stats.windows_skipped;
+  stats[2] = s_stem_bound_stats.core_stems;
+  stats[3] = s_stem_bound_stats.core_stems_skipped;
+}
@@ -14,6 +14,7 @@ public:
 
   Bands(ReadInput *R, Stack *S);
   ~Bands();
+  void Reset(int n); // Finds the initial pattern, clearing the first n entries
   void Output(int border1, int border2, int NumberOfBands);
   int Find_next_good_index(int i, int border1, int border2);
   void aux_Find_bands(int border1, int border2, int *NumberOfBands,
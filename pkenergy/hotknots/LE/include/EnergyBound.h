@@ -0,0 +1,19 @@
+#ifndef ENERGYBOUND_H
+#define ENERGYBOUND_H
+
+// Cheap lower bound for the MFE of a structure, computed from the loaded
+// parameter tables without building the loop tree. The exact stacking and
+// hairpin terms of the structure are added to the pseudoloop initiation
+// penalties, and every other loop is assumed to get the most favourable
+// mismatch, dangling end and coaxial stacking terms the tables allow. The
+// bound is only derived for the DP model. For other models it is -HUGE_VAL,
+// so that no structure is ever skipped.
+
+// Prepare the bound for the parameters of an energy model. Must be called
+// after the parameters are loaded, and before any bounds are calculated.
+void energy_bound_init(int model);
+
+// Lower bound (kcal/mol) for the MFE of a structure with size bases.
+double energy_lower_bound(int size, char *sequence, char *structure);
+
+#endif
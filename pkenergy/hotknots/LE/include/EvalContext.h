@@ -0,0 +1,71 @@
+#ifndef EVALCONTEXT_H
+#define EVALCONTEXT_H
+
+#include <map>
+#include <vector>
+
+#include "Bands.h"
+#include "Input.h"
+#include "Loop.h"
+#include "Stack.h"
+
+// EvalContext holds the objects needed to evaluate the energy of a structure.
+// They are allocated once, and reset between structures instead of being
+// reallocated, so that evaluating many structures of a sequence is cheap.
+class EvalContext {
+
+public:
+  EvalContext(int size);
+  ~EvalContext();
+
+  // Calculate the MFE of a structure with size bases using an energy model.
+  double Energy(int size, char *sequence, char *structure, int model);
+
+  // Same as Energy() for each of nmodels energy models, writing the MFE with
+  // models[i] to out[i]. The tree of closed regions is built once, and shared
+  // by all models.
+  void EnergyMulti(int size, char *sequence, char *structure,
+                   const int *models, int nmodels, double *out);
+
+  // Incremental evaluation. SetBase() calculates the MFE of a structure and
+  // keeps the energy of each of its top-level closed regions. EnergyEdit()
+  // calculates the MFE of the base structure after removing and adding some
+  // base pairs (given as pairs of 0-based indices), re-scoring only the
+  // top-level closed regions affected by the edit. The result is the same as
+  // Energy() on the edited structure. Only DP and CC2006b are re-scored
+  // incrementally, other models evaluate the edited structure from scratch.
+  double SetBase(int size, char *sequence, char *structure, int model);
+  double EnergyEdit(const int *removed, int nremove, const int *added,
+                    int nadd);
+
+  // ATTRIBUTES
+  ReadInput *Input;
+  Stack *St;
+  Bands *bandpattern;
+
+private:
+  void Reset(int size, char *sequence);
+  Loop *Build(int size, char *sequence);
+  float RegionEnergy(Loop *L, int model);
+  double Finish(Loop *L, float sum, int model);
+
+  short *pairseq; // base pairs of the current structure
+  int capacity;   // number of entries in pairseq
+  int used;       // largest size evaluated since the last full reset
+
+  // energy of a top-level closed region of the base structure, and the
+  // no-dangling restrictions it added while being evaluated
+  struct Region {
+    int end;
+    float energy;
+    std::vector<int> restricted;
+  };
+
+  bool hasBase;
+  int baseSize, baseModel;
+  std::vector<char> baseSequence;
+  std::vector<short> basePairs;
+  std::map<int, Region> baseRegions; // top-level closed regions by begin
+};
+
+#endif
@@ -22,6 +22,11 @@ public:
   ReadInput(int size, char *baseSequence, short *pairRefSequence);
   ~ReadInput();
 
+  // Reuse the object for another structure: Clear() restores the first n
+  // entries of each array (and frees their loop lists), Load() fills them in.
+  void Clear(int n);
+  void Load(int size, char *baseSequence, short *pairRefSequence);
+
   int BasePair(
       int a); // The base pair of an element. Is -1 if the element is not paired
 
@@ -0,0 +1,28 @@
+#ifndef PARAMSNAPSHOT_H
+#define PARAMSNAPSHOT_H
+
+// Binary snapshot of the parameter tables that init_data(),
+// fill_data_structures_with_new_parameters() and init_dataPK() fill in, so
+// that they can be restored without parsing the text parameter files again.
+//
+// The snapshot starts with a header (magic, format version, byte order) and a
+// table of sections, one per parameter table, with the name, offset and size
+// of each. A snapshot is only loaded if the version and all sections match
+// those of the running library exactly, so snapshots written by a build with
+// different table sizes or a different format are rejected.
+
+// Version of the snapshot format. Increase when sections are added, removed
+// or reordered.
+#define PARAM_SNAPSHOT_VERSION 1
+
+// Write the current parameter tables to path. Returns 0 on success, -1 on
+// failure.
+int param_snapshot_write(const char *path);
+
+// Map the snapshot at path, check it, and copy its sections to the parameter
+// tables. Returns 0 on success, -1 on failure, in which case the parameter
+// tables are left untouched. Not thread-safe, must not be called while
+// energies are being calculated.
+int param_snapshot_read(const char *path);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef REGIONCACHE_H
+#define REGIONCACHE_H
+
+// Memo cache for the energies of the pseudoknot-free regions that
+// Loop::pkfreeEnergy*() and Loop::nestedPseudoEnergy*() pass to simfold.
+// Each thread keeps its own LRU cache of up to `entries` regions, keyed by the
+// region's sequence and structure, so there is no locking. The cache is
+// disabled (0 entries) by default.
+
+// Same as get_feature_counts_restricted() with c == NULL, looking up the
+// energy in the cache of the calling thread first.
+double region_energy_cached(char *sequence, char *structure, int ignore_dangles,
+                            int ignore_first_AU_penalty);
+
+// Set the maximum number of entries of each thread's cache, and clear all
+// caches and counters. 0 disables the cache. Not thread-safe, must not be
+// called while energies are being calculated.
+void region_cache_configure(int entries);
+
+// Number of cache hits and misses since the last region_cache_configure().
+void region_cache_stats(long *hits, long *misses);
+
+#endif
@@ -60,27 +60,27 @@ extern int coaxstack_m2[NUCL][NUCL][NUCL]
 extern char string_params_PK_CC[5000]
                                [MAXPNAME]; // for playing with the parameters
 
-// PARAMETER TUNING
+// PARAMETER TUNING (per thread, see globalsPK.h)
 
-extern int g_count_Ps;  // pseudoloop initiation energy
-extern int g_count_Psm; // penalty for introducing pseudoknot inside a multiloop
-extern int
+extern thread_local int g_count_Ps;  // pseudoloop initiation energy
+extern thread_local int g_count_Psm; // penalty for introducing pseudoknot inside a multiloop
+extern thread_local int
     g_count_Psp; // penalty for introducting pseudoknot inside a pseudoloop
-extern int g_count_Pb;  // penalty for band
-extern int g_count_Pup; // penalty for unpaired base in pseudoloop or band
-extern int g_count_Pps; // penalty for nested closed region inside either a
+extern thread_local int g_count_Pb;  // penalty for band
+extern thread_local int g_count_Pup; // penalty for unpaired base in pseudoloop or band
+extern thread_local int g_count_Pps; // penalty for nested closed region inside either a
                         // pseudoloop or a multiloop that spans a band
-extern int
+extern thread_local int
     g_count_stP; // multiplicative penalty for stacked pair that spans a band
-extern int
+extern thread_local int
     g_count_intP; // multiplicative penalty for internal loop that spans a band
-extern int g_count_a;   // penalty for introducing a multiloop
-extern int g_count_a_p; // penalty for introducing a multiloop that spans a band
-extern int g_count_b;   // penalty for multiloop base pair
-extern int g_count_b_p; // penalty for multiloop base pair when the multiloop
+extern thread_local int g_count_a;   // penalty for introducing a multiloop
+extern thread_local int g_count_a_p; // penalty for introducing a multiloop that spans a band
+extern thread_local int g_count_b;   // penalty for multiloop base pair
+extern thread_local int g_count_b_p; // penalty for multiloop base pair when the multiloop
                         // spans a band
-extern int g_count_c;   // penalty for unpaired base in multiloop
-extern int g_count_c_p;
+extern thread_local int g_count_c;   // penalty for unpaired base in multiloop
+extern thread_local int g_count_c_p;
 
 // parameters from the configuration file
 extern char par_namePK[14][100]; // *** Add new energy model code here -- change
@@ -106,24 +106,26 @@ char *rna_coaxstack_m2_par = par_valuePK[12];
 char *dna_coaxstack_m2_par = par_valuePK[13];
 
 // PARAMETER TUNING
+// These counters are updated while evaluating a structure, so they are kept per
+// thread.
 
-int g_count_Ps = 0;  // pseudoloop initiation energy
-int g_count_Psm = 0; // penalty for introducing pseudoknot inside a multiloop
-int g_count_Psp = 0; // penalty for introducting pseudoknot inside a pseudoloop
-int g_count_Pb = 0;  // penalty for band
-int g_count_Pup = 0; // penalty for unpaired base in pseudoloop or band
-int g_count_Pps = 0; // penalty for nested closed region inside either a
+thread_local int g_count_Ps = 0;  // pseudoloop initiation energy
+thread_local int g_count_Psm = 0; // penalty for introducing pseudoknot inside a multiloop
+thread_local int g_count_Psp = 0; // penalty for introducting pseudoknot inside a pseudoloop
+thread_local int g_count_Pb = 0;  // penalty for band
+thread_local int g_count_Pup = 0; // penalty for unpaired base in pseudoloop or band
+thread_local int g_count_Pps = 0; // penalty for nested closed region inside either a
                      // pseudoloop or a multiloop that spans a band
-int g_count_stP =
+thread_local int g_count_stP =
     0; // multiplicative penalty for stacked pair that spans a band
-int g_count_intP =
+thread_local int g_count_intP =
     0;             // multiplicative penalty for internal loop that spans a band
-int g_count_a = 0; // penalty for introducing a multiloop
-int g_count_a_p = 0; // penalty for introducing a multiloop that spans a band
-int g_count_b = 0;   // penalty for multiloop base pair
-int g_count_b_p =
+thread_local int g_count_a = 0; // penalty for introducing a multiloop
+thread_local int g_count_a_p = 0; // penalty for introducing a multiloop that spans a band
+thread_local int g_count_b = 0;   // penalty for multiloop base pair
+thread_local int g_count_b_p =
     0; // penalty for multiloop base pair when the multiloop spans a band
-int g_count_c = 0; // penalty for unpaired base in multiloop
-int g_count_c_p = 0;
+thread_local int g_count_c = 0; // penalty for unpaired base in multiloop
+thread_local int g_count_c_p = 0;
 
 #endif
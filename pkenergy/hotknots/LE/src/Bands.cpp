@@ -26,7 +26,16 @@ Bands::Bands(ReadInput *R, Stack *S) {
   Input = R;
   St = S;
   pattern = new B_pattern[MaxN];
-  memset(pattern, 0, MaxN * sizeof(B_pattern));
+  Reset(MaxN);
+};
+
+/*********************************************************************************
+Reset: Recomputes the initial pattern after the input has changed, so that the
+object can be reused for another structure. Only the first n entries are
+cleared.
+*********************************************************************************/
+void Bands::Reset(int n) {
+  memset(pattern, 0, n * sizeof(B_pattern));
 
   int i;
   for (i = 1; i <= Input->Size; i++) {
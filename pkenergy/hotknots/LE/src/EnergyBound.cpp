@@ -0,0 +1,262 @@
+// Author: Angelos Kolaitis
+// Email: neoaggelos@gmail.com
+// Date: 2023-03-14
+// Description: Lower bound for the MFE of a structure, used to skip candidate
+//              structures that cannot beat the best energies found so far.
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "EnergyBound.h"
+#include "common.h"          // nuc_to_int(), AU_penalty()
+#include "constantsPK.h"     // DP
+#include "externs.h"         // simfold parameter tables
+#include "externsPK.h"       // pkmodelDP, coaxstack_*
+#include "s_hairpin_loop.h"  // s_hairpin_loop::get_energy()
+#include "s_internal_loop.h" // s_internal_loop::get_energy()
+
+// All of the below are set by energy_bound_init(), and only read afterwards.
+static int gBoundModel = -1;
+
+// Most favourable dangling end energy (10cal/mol) of base x on a pair of type
+// [a][b], in either orientation.
+static int gDangle[NUCL][NUCL][NUCL];
+
+// Most favourable coaxial stacking energy (10cal/mol) of a pair of type [a][b]
+// with any other pair, flush or mismatched.
+static int gCoax[NUCL][NUCL];
+
+// Smallest pseudoloop initiation penalty (kcal/mol).
+static double gPseudoMin;
+
+static inline int favourable(int energy) { return energy < 0 ? energy : 0; }
+
+// Most favourable entry of a table that has a pair of type [a][b] on either
+// side.
+static int table_min(int table[NUCL][NUCL][NUCL][NUCL], int a, int b) {
+  int result = 0;
+  for (int x = 0; x < NUCL; x++) {
+    for (int y = 0; y < NUCL; y++) {
+      result = std::min(result, table[a][b][x][y]);
+      result = std::min(result, table[x][y][a][b]);
+    }
+  }
+  return result;
+}
+
+void energy_bound_init(int model) {
+  gBoundModel = model;
+  if (model != DP) {
+    return;
+  }
+
+  for (int a = 0; a < NUCL; a++) {
+    for (int b = 0; b < NUCL; b++) {
+      for (int x = 0; x < NUCL; x++) {
+        gDangle[a][b][x] = favourable(std::min(
+            std::min(dangle_top[a][b][x], dangle_top[b][a][x]),
+            std::min(dangle_bot[a][b][x], dangle_bot[b][a][x])));
+      }
+
+      int coax = 0;
+      for (int k = 0; k < 2; k++) {
+        int p = k ? b : a, q = k ? a : b;
+        coax = std::min(coax, table_min(stack, p, q));
+        coax = std::min(coax, table_min(coaxstack_f_a, p, q));
+        coax = std::min(coax, table_min(coaxstack_f_b, p, q));
+        coax = std::min(coax, table_min(coaxstack_m1, p, q));
+        coax = std::min(coax, table_min(coaxstack_m2, p, q));
+      }
+      gCoax[a][b] = coax;
+    }
+  }
+
+  gPseudoMin = std::max(
+      0.0, std::min(pkmodelDP.Ps, std::min(pkmodelDP.Psm, pkmodelDP.Psp)));
+}
+
+// Most favourable energy of the terms that the end of the helix closed by
+// (i, j) can get from a multiloop, pseudoloop or the external loop. x5 and x3
+// are the bases next to it on that loop (outside or inside the pair), and
+// step is the direction away from the pair (-1 for x5 outside).
+static int end_min(const std::vector<short> &pairs, const std::vector<int> &seq,
+                   int size, int i, int j, int x5, int x3, int step) {
+  int a = seq[i - 1], b = seq[j - 1];
+  int energy = favourable(misc.terminal_AU_penalty);
+  bool coax = false;
+
+  int sides[2][2] = {{x5, x5 + step}, {x3, x3 - step}};
+  for (int s = 0; s < 2; s++) {
+    int x = sides[s][0];
+    if (x < 1 || x > size) {
+      continue;
+    }
+    if (pairs[x] == 0) {
+      energy += gDangle[a][b][seq[x - 1]];
+    }
+
+    // coaxial stacking needs another helix at most one base away
+    for (int k = 0; k < 2; k++) {
+      int y = sides[s][k];
+      coax |= y >= 1 && y <= size && pairs[y] != 0;
+    }
+  }
+
+  if (coax) {
+    energy += gCoax[a][b];
+  }
+  return energy;
+}
+
+// Buffers of energy_lower_bound(), kept per thread to avoid allocations.
+namespace {
+struct BoundScratch {
+  std::vector<short> pairs;
+  std::vector<int> seq, prev, left, right, group;
+  std::vector<char> cseq, internal, crossing;
+};
+} // namespace
+
+static thread_local BoundScratch tScratch;
+
+double energy_lower_bound(int size, char *sequence, char *structure) {
+  if (gBoundModel != DP) {
+    return -HUGE_VAL;
+  }
+
+  // pairs is 1-based (0 for unpaired bases), seq and cseq are 0-based. The
+  // bracket types are the same as in detect_original_PKed_pairs_many(). The
+  // open brackets of each type are kept as a linked list through prev.
+  static const char bl[] = "([{<ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  static const char br[] = ")]}>abcdefghijklmnopqrstuvwxyz";
+  BoundScratch &b = tScratch;
+  std::vector<short> &pairs = b.pairs;
+  pairs.assign(size + 2, 0);
+  b.prev.resize(size + 1);
+  int top[sizeof(bl) - 1] = {0};
+  for (int i = 1; i <= size; i++) {
+    char c = structure[i - 1];
+    const char *p;
+    if (c == '.') {
+      continue;
+    } else if ((p = strchr(bl, c)) != NULL) {
+      b.prev[i] = top[p - bl];
+      top[p - bl] = i;
+    } else if ((p = strchr(br, c)) != NULL && top[p - br] != 0) {
+      int j = top[p - br];
+      top[p - br] = b.prev[j];
+      pairs[i] = j;
+      pairs[j] = i;
+    }
+  }
+
+  std::vector<int> &seq = b.seq;
+  std::vector<char> &cseq = b.cseq;
+  seq.resize(size);
+  cseq.resize(size + 1);
+  for (int i = 0; i < size; i++) {
+    cseq[i] = toupper(sequence[i]);
+    seq[i] = nuc_to_int(cseq[i]);
+  }
+  cseq[size] = '\0';
+
+  double energy = 0; // 10cal/mol
+
+  // internal[k] is set if (k, pairs[k]) is the inner pair of an internal loop
+  std::vector<char> &internal = b.internal;
+  internal.assign(size + 2, 0);
+  b.left.clear();
+  b.right.clear();
+  for (int i = 1; i <= size; i++) {
+    int j = pairs[i];
+    if (j <= i) {
+      continue;
+    }
+    b.left.push_back(i);
+    b.right.push_back(j);
+
+    // the loop closed by (i, j)
+    int k = i + 1;
+    while (k < j && pairs[k] == 0) {
+      k++;
+    }
+    int l = k < j ? pairs[k] : 0;
+    int m = l + 1;
+    while (l > k && l < j && m < j && pairs[m] == 0) {
+      m++;
+    }
+
+    if (k == j) {
+      // hairpin, smaller than 3 bases is not allowed anyway
+      if (j - i - 1 >= 3) {
+        energy += s_hairpin_loop::get_energy(i - 1, j - 1, &seq[0], &cseq[0],
+                                             NULL);
+      }
+    } else if (l > k && l < j && m == j) {
+      // stacked pair or internal loop, possibly spanning a band. these are
+      // scaled by stP or intP, and may skip the AU penalties of their pairs
+      double e;
+      if (k > i + 1 || l < j - 1) {
+        e = s_internal_loop::get_energy(i - 1, j - 1, k - 1, l - 1, &seq[0],
+                                        NULL);
+        e -= std::max(0, (int)AU_penalty(seq[i - 1], seq[j - 1]));
+        e -= std::max(0, (int)AU_penalty(seq[k - 1], seq[l - 1]));
+        e = std::min(e, e * pkmodelDP.intP);
+      } else {
+        e = stack[seq[i - 1]][seq[j - 1]][seq[k - 1]][seq[l - 1]];
+        e = std::min(e, e * pkmodelDP.stP);
+      }
+      energy += e;
+      internal[k] = 1;
+    } else {
+      energy += end_min(pairs, seq, size, i, j, i + 1, j - 1, 1);
+    }
+
+    // the loop that (i, j) is a branch of
+    if (!internal[i]) {
+      energy += end_min(pairs, seq, size, i, j, i - 1, j + 1, -1);
+    }
+  }
+
+  // each group of crossing pairs is a pseudoloop of its own
+  const std::vector<int> &left = b.left, &right = b.right;
+  std::vector<int> &group = b.group;
+  std::vector<char> &crossing = b.crossing;
+  int n = left.size();
+  group.resize(n);
+  crossing.assign(n, 0);
+  for (int x = 0; x < n; x++) {
+    group[x] = x;
+  }
+  for (int x = 0; x < n; x++) {
+    for (int y = x + 1; y < n && left[y] < right[x]; y++) {
+      if (right[y] > right[x]) {
+        int gx = x, gy = y;
+        while (group[gx] != gx)
+          gx = group[gx];
+        while (group[gy] != gy)
+          gy = group[gy];
+        group[gy] = gx;
+        crossing[x] = crossing[y] = 1;
+      }
+    }
+  }
+  int pseudoloops = 0;
+  for (int x = 0; x < n; x++) {
+    pseudoloops += crossing[x] && group[x] == x;
+  }
+  return energy / 100 + pseudoloops * gPseudoMin;
+}
@@ -13,25 +13,61 @@
  *                                                                         *
  ***************************************************************************/
 
+#include <ctype.h>
+#include <omp.h>
 #include <stdio.h>
 #include <string.h>
 
-#include "Bands.h"
-#include "Input.h"
-#include "Loop.h"
-#include "Stack.h"
-#include "commonPK.h" // detect_original_PKed_pairs_many()
+#include <memory>
+
+#include "EnergyBound.h"
+#include "EvalContext.h"
+#include "ParamSnapshot.h"
+#include "RegionCache.h"
+#include "commonPK.h" // create_string_params_PK_CC()
 #include "init.h"     // init_data()
 #include "initPK.h"   // init_dataPK()
 #include "params.h"   // fill_data_structures_with_new_parameters(), RNA
 
 extern "C" {
 
+// The parameter tables and the energy model are set by initialize(), and are
+// only read afterwards. Everything that changes while evaluating a structure
+// lives in a per-thread EvalContext (or is marked thread_local in simfold).
 static int gEnergyModel = DP; // DP, RE, CC2006a, CC2006b, CC2006c
 
+// Region cache size of each energy model, see set_energy_cache().
+static int gCacheEntries[CC2006c + 1];
+
+// Select the energy model, and prepare everything that depends on the
+// loaded parameters.
+static void configure(char *model) {
+  if (model == NULL || strncmp(model, "dp", 2) == 0) {
+    gEnergyModel = DP;
+  } else if (strncmp(model, "re", 2) == 0) {
+    gEnergyModel = RE;
+  } else if (strncmp(model, "cc2006a", 7) == 0) {
+    gEnergyModel = CC2006a;
+  } else if (strncmp(model, "cc2006b", 7) == 0) {
+    gEnergyModel = CC2006b;
+  } else if (strncmp(model, "cc2006c", 7) == 0) {
+    gEnergyModel = CC2006c;
+  }
+
+  // create the parameter names now, so that threads only read them.
+  get_num_params();
+
+  // cached energies were calculated with the previous parameters, start over
+  // with the cache size of the selected model.
+  region_cache_configure(gCacheEntries[gEnergyModel]);
+
+  energy_bound_init(gEnergyModel);
+}
+
 // initialize is called once before starting energy calculations to load
 // parameters. It should point to the `hotknots/params` directory of this
-// repository.
+// repository. It is not thread-safe, and must not be called while energies
+// are being calculated.
 void initialize(char *config_dir, char *model) {
   char multirnafold[200], pkenergy[200], constrdangles[200];
   snprintf(multirnafold, 200, "%s/multirnafold.conf", config_dir);
@@ -43,45 +79,143 @@ void initialize(char *config_dir, char *model) {
   fill_data_structures_with_new_parameters(constrdangles);
   init_dataPK("", pkenergy, RNA, 37);
 
-  // configure energy model to use.
-  if (model == NULL || strncmp(model, "dp", 2) == 0) {
-    gEnergyModel = DP;
-  } else if (strncmp(model, "re", 2) == 0) {
-    gEnergyModel = RE;
-  } else if (strncmp(model, "cc2006a", 7) == 0) {
-    gEnergyModel = CC2006a;
-  } else if (strncmp(model, "cc2006b", 7) == 0) {
-    gEnergyModel = CC2006b;
-  } else if (strncmp(model, "cc2006c", 7) == 0) {
-    gEnergyModel = CC2006c;
+  configure(model);
+}
+
+// Write the parameters loaded by initialize() to a binary snapshot at path.
+// Returns 0 on success, -1 on failure.
+int export_parameters(char *path) { return param_snapshot_write(path); }
+
+// Same as initialize(), loading the parameters from a snapshot written by
+// export_parameters() instead of parsing the parameter files. Returns 0 on
+// success. Returns -1 if the snapshot cannot be read or was written by an
+// incompatible version of the library, without changing any parameters.
+int initialize_from_snapshot(char *path, char *model) {
+  if (param_snapshot_read(path) != 0) {
+    return -1;
   }
+  create_string_params_PK_CC();
+
+  configure(model);
+  return 0;
+}
+
+// Cache the energies of up to entries pseudoknot-free regions in each thread,
+// reusing them across structures and batches until the next call to
+// initialize() or set_energy_cache(). 0 disables the cache. The size is kept
+// for the selected energy model, and is restored whenever initialize() selects
+// that model again. It is not thread-safe, and must not be called while
+// energies are being calculated.
+void set_energy_cache(int entries) {
+  gCacheEntries[gEnergyModel] = entries;
+  region_cache_configure(entries);
+}
+
+// Number of cache hits and misses since the last call to set_energy_cache()
+// or initialize().
+void get_energy_cache_stats(long *hits, long *misses) {
+  region_cache_stats(hits, misses);
+}
+
+// Evaluation context of each thread, created on first use and freed when the
+// thread exits.
+static thread_local std::unique_ptr<EvalContext> tContext;
+
+static EvalContext *context(int size) {
+  if (!tContext) {
+    tContext.reset(new EvalContext(size));
+  }
+  return tContext.get();
+}
+
+// Uppercase copy of a sequence, shared by the batch functions.
+static char *upper_sequence(const char *sequence, int size) {
+  char *upper = new char[size + 1];
+  for (int i = 0; i <= size; i++) {
+    upper[i] = toupper(sequence[i]);
+  }
+  return upper;
 }
 
 // Given an RNA sequence and its secondary structure, calculate the MFE
 double get_energy(char *sequence, char *structure) {
   int size = strlen(structure);
-  short pairseq[size + 1];
-  detect_original_PKed_pairs_many(structure, pairseq);
-
-  ReadInput *R = new ReadInput(size, sequence, pairseq);
-  Stack *s = new Stack(R);
-  Bands *B = new Bands(R, s);
-  Loop *L = new Loop(0, MaxN + 1, R, B, s);
-
-  for (int i = 1; i <= R->Size; i++) {
-    if (R->BasePair(i) >= 0) {
-      int a, b; // will store the borders of a closed region
-      if (s->Add(i, a, b)) {
-        // If a closed region is identifed add it to the tree by calling addLoop
-        L->addLoop(a, b);
-      };
-    };
+  return context(size)->Energy(size, sequence, structure, gEnergyModel);
+}
+
+// Same as get_energy() with each of nmodels energy models, writing the MFE
+// with models[i] to out[i]. Models are given by their ids (RE = 0, DP = 1,
+// CC2006a = 2, CC2006b = 3, CC2006c = 4), and do not depend on the model
+// passed to initialize(). The structure is parsed once for all models.
+void get_energy_multi(char *sequence, char *structure, const int *models,
+                      int nmodels, double *out) {
+  int size = strlen(structure);
+  context(size)->EnergyMulti(size, sequence, structure, models, nmodels, out);
+}
+
+// Same as get_energy() for n structures of the same sequence, writing the MFE
+// of structures[i] to out[i]. The sequence is prepared once, and the
+// evaluation context is reused for all structures. All structures must have
+// the length of the sequence.
+void get_energies(const char *sequence, const char **structures, int n,
+                  double *out) {
+  int size = strlen(sequence);
+  char *upper = upper_sequence(sequence, size);
+
+  EvalContext *ctx = context(size);
+  for (int k = 0; k < n; k++) {
+    out[k] = ctx->Energy(size, upper, (char *)structures[k], gEnergyModel);
+  }
+
+  delete[] upper;
+}
+
+// Calculate the MFE of a base structure, and keep it for get_energy_edit() in
+// the context of the calling thread.
+double set_base_structure(char *sequence, char *structure) {
+  int size = strlen(structure);
+  return context(size)->SetBase(size, sequence, structure, gEnergyModel);
+}
+
+// Calculate the MFE of the last base structure of the calling thread after
+// removing nremove and adding nadd base pairs. removed and added hold pairs of
+// 0-based indices (i0, j0, i1, j1, ...). Only the closed regions affected by
+// the edit are evaluated again, and the result is the same as get_energy() on
+// the edited structure.
+double get_energy_edit(const int *removed, int nremove, const int *added,
+                       int nadd) {
+  return context(0)->EnergyEdit(removed, nremove, added, nadd);
+}
+
+// Lower bound for the MFE of each structure, which is much cheaper to
+// calculate than the MFE itself. A structure whose bound is higher than an
+// energy found already cannot have a lower MFE. Bounds are only derived for
+// the DP model, and are -HUGE_VAL for other models.
+void get_energy_bounds(const char *sequence, const char **structures, int n,
+                       double *out) {
+  for (int i = 0; i < n; i++) {
+    int size = strlen(structures[i]);
+    out[i] = energy_lower_bound(size, (char *)sequence, (char *)structures[i]);
+  }
+}
+
+// Same as get_energies(), with the structures split across nthreads threads.
+// Each thread uses its own evaluation context. If nthreads is not positive,
+// all available cores are used.
+void get_energies_parallel(const char *sequence, const char **structures,
+                           int n, double *out, int nthreads) {
+  int size = strlen(sequence);
+  char *upper = upper_sequence(sequence, size);
+  if (nthreads <= 0) {
+    nthreads = omp_get_num_procs();
+  }
+
+#pragma omp parallel for num_threads(nthreads) schedule(dynamic, 16)
+  for (int k = 0; k < n; k++) {
+    out[k] = context(size)->Energy(size, upper, (char *)structures[k],
+                                   gEnergyModel);
   }
-  double result = (-L->EnergyViaSimfold(gEnergyModel) -
-                   L->EnergyDanglingViaSimfold(gEnergyModel)) /
-                  1000;
 
-  delete R, s, B, L;
-  return result;
+  delete[] upper;
 }
 }
@@ -0,0 +1,219 @@
+// Author: Angelos Kolaitis
+// Email: neoaggelos@gmail.com
+// Date: 2023-03-02
+// Description: Reusable context for energy evaluation. ReadInput, Stack and
+//              Bands are allocated once and only the entries touched by the
+//              previous structure are reset before evaluating the next one.
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "EvalContext.h"
+#include "Loop.h"
+#include "commonPK.h"    // detect_original_PKed_pairs_many()
+#include "constantsPK.h" // no_pk_dangling_ends
+
+EvalContext::EvalContext(int size) {
+  capacity = size + 1;
+  pairseq = new short[capacity];
+  pairseq[0] = 0;
+
+  // the objects start out as an empty structure; the first call to Energy()
+  // clears the arrays up to the size of the first structure.
+  char empty[1] = {'A'};
+  Input = new ReadInput(0, empty, pairseq);
+  St = new Stack(Input);
+  bandpattern = new Bands(Input, St);
+  used = 0;
+  hasBase = false;
+}
+
+EvalContext::~EvalContext() {
+  delete bandpattern;
+  delete St;
+  delete Input;
+  delete[] pairseq;
+}
+
+// Reset clears the entries written by the previous structure (up to its size
+// plus one) and loads the current one.
+void EvalContext::Reset(int size, char *sequence) {
+  int n = MIN(MAX(size, used) + 2, MaxN);
+  used = size;
+
+  Input->Clear(n);
+  Input->Load(size, sequence, pairseq);
+  St->Reset(n);
+  bandpattern->Reset(n);
+}
+
+// Build the tree of closed regions for the base pairs in pairseq.
+Loop *EvalContext::Build(int size, char *sequence) {
+  Reset(size, sequence);
+
+  Loop *L = new Loop(0, MaxN + 1, Input, bandpattern, St);
+  for (int i = 1; i <= Input->Size; i++) {
+    if (Input->BasePair(i) >= 0) {
+      int a, b; // will store the borders of a closed region
+      if (St->Add(i, a, b)) {
+        // If a closed region is identifed add it to the tree by calling addLoop
+        L->addLoop(a, b);
+      };
+    };
+  }
+  return L;
+}
+
+double EvalContext::Energy(int size, char *sequence, char *structure,
+                           int model) {
+  double result;
+  EnergyMulti(size, sequence, structure, &model, 1, &result);
+  return result;
+}
+
+void EvalContext::EnergyMulti(int size, char *sequence, char *structure,
+                              const int *models, int nmodels, double *out) {
+  if (size + 1 > capacity) {
+    delete[] pairseq;
+    capacity = size + 1;
+    pairseq = new short[capacity];
+  }
+  detect_original_PKed_pairs_many(structure, pairseq);
+
+  // EnergyDanglingViaSimfold() clears the dangling restrictions added by
+  // EnergyViaSimfold(), so the next model starts from the same tree.
+  Loop *L = Build(size, sequence);
+  for (int k = 0; k < nmodels; k++) {
+    out[k] = (-L->EnergyViaSimfold(models[k]) -
+              L->EnergyDanglingViaSimfold(models[k])) /
+             1000;
+  }
+
+  delete L;
+}
+
+// Energy of a top-level closed region, as summed by Loop::getEnergyDP() and
+// Loop::getEnergyCC2006b() for the root of the tree.
+float EvalContext::RegionEnergy(Loop *L, int model) {
+  double free_value = 0;
+  if (model == DP)
+    return L->getEnergyDP(NULL, NULL, free_value, 0, no_pk_dangling_ends);
+  return L->getEnergyCC2006b(NULL, NULL, free_value, 0, no_pk_dangling_ends);
+}
+
+// Same arithmetic as Energy(), given the sum of the energies of the top-level
+// closed regions of the tree rooted at L.
+double EvalContext::Finish(Loop *L, float sum, int model) {
+  float energy = -sum;          // Loop::Energy()
+  float retval = 1000 * energy; // Loop::EnergyViaSimfold()
+  return (-retval - L->EnergyDanglingViaSimfold(model)) / 1000;
+}
+
+double EvalContext::SetBase(int size, char *sequence, char *structure,
+                            int model) {
+  hasBase = true;
+  baseSize = size;
+  baseModel = model;
+  baseSequence.assign(sequence, sequence + size + 1);
+  baseRegions.clear();
+
+  if (model != DP && model != CC2006b) {
+    double result = Energy(size, sequence, structure, model);
+    basePairs.assign(pairseq, pairseq + size + 1);
+    return result;
+  }
+
+  if (size + 1 > capacity) {
+    delete[] pairseq;
+    capacity = size + 1;
+    pairseq = new short[capacity];
+  }
+  detect_original_PKed_pairs_many(structure, pairseq);
+  basePairs.assign(pairseq, pairseq + size + 1);
+
+  Loop *L = Build(size, sequence);
+  int *restrictions = Input->cannot_add_dangling;
+  std::vector<int> before(size + 2);
+  float sum = 0;
+  for (Loop *R = L->RightChild; R != NULL; R = R->LeftSibling) {
+    before.assign(restrictions, restrictions + size + 2);
+
+    Region &region = baseRegions[R->begin];
+    region.end = R->end;
+    region.energy = RegionEnergy(R, model);
+    for (int i = 0; i < size + 2; i++) {
+      if (restrictions[i] && !before[i])
+        region.restricted.push_back(i);
+    }
+    sum += region.energy;
+  }
+
+  double result = Finish(L, sum, model);
+  delete L;
+  return result;
+}
+
+double EvalContext::EnergyEdit(const int *removed, int nremove,
+                               const int *added, int nadd) {
+  if (!hasBase) {
+    fprintf(stderr, "EnergyEdit: no base structure\n");
+    return 0;
+  }
+
+  int size = baseSize;
+  std::copy(basePairs.begin(), basePairs.end(), pairseq);
+
+  // pairseq is 1-based, mark the positions touched by the edit
+  std::vector<char> changed(size + 2, 0);
+  for (int k = 0; k < nremove; k++) {
+    int i = removed[2 * k] + 1, j = removed[2 * k + 1] + 1;
+    pairseq[i] = pairseq[j] = 0;
+    changed[i] = changed[j] = 1;
+  }
+  for (int k = 0; k < nadd; k++) {
+    int i = added[2 * k] + 1, j = added[2 * k + 1] + 1;
+    pairseq[i] = j;
+    pairseq[j] = i;
+    changed[i] = changed[j] = 1;
+  }
+
+  int model = baseModel;
+  Loop *L = Build(size, &baseSequence[0]);
+  if (model != DP && model != CC2006b) {
+    double result =
+        (-L->EnergyViaSimfold(model) - L->EnergyDanglingViaSimfold(model)) /
+        1000;
+    delete L;
+    return result;
+  }
+
+  // a top-level closed region that is also in the base structure is reused if
+  // the edit does not touch it or the bases right next to it.
+  float sum = 0;
+  for (Loop *R = L->RightChild; R != NULL; R = R->LeftSibling) {
+    std::map<int, Region>::iterator it = baseRegions.find(R->begin);
+    bool reuse = it != baseRegions.end() && it->second.end == R->end;
+    for (int i = MAX(R->begin - 1, 0); reuse && i <= R->end + 1; i++) {
+      reuse = !changed[i];
+    }
+
+    if (reuse) {
+      for (size_t k = 0; k < it->second.restricted.size(); k++) {
+        Input->cannot_add_dangling[it->second.restricted[k]] = 1;
+      }
+      sum += it->second.energy;
+    } else {
+      sum += RegionEnergy(R, model);
+    }
+  }
+
+  double result = Finish(L, sum, model);
+  delete L;
+  return result;
+}
@@ -194,19 +194,44 @@ input-structures according to these information!
 *****************************************************************************************/
 
 ReadInput::ReadInput(int size, char *baseSequence, short *pairRefSequence) {
+  for (int i = 0; i < MaxN; i++)
+    looplists[i] = NULL;
 
-  for (int i = 0; i < MaxN; i++) {
+  Clear(MaxN);
+  Load(size, baseSequence, pairRefSequence);
+}
+
+/****************************************************************************************
+Clear: Resets the first n entries of the input-structures to their initial
+values, so that the object can be reused for another secondary structure. Only
+entries up to Size + 1 are written while a structure is evaluated, so n need not
+be larger than that.
+*****************************************************************************************/
+void ReadInput::Clear(int n) {
+  for (int i = 0; i < n; i++) {
+    if (looplists[i] != NULL)
+      delete looplists[i];
+    looplists[i] = NULL;
     Sequence[i] = -1;
     CSequence[i] = ' ';
-    looplists[i] = NULL;
     loops[i].pair = 0;
+    loops[i].type = NONE;
+    loops[i].num_branches = 0;
+    loops[i].pseudo_num_branches = 0;
     Next[i] = 0;
     Prev[i] = 0;
     type[i] = 0;
     cannot_add_dangling[i] = 0;
-    //		must_add_dangling[i] = 0;   // Cristina: June 11 added
-  };
+    ClosedRegions[i] = NULL;
+  }
+  Size = 0;
+}
 
+/****************************************************************************************
+Load: Fills the cleared input-structures with the RNA primary structure
+(baseSequence) and secondary structure (pairRefSequence) of length size.
+*****************************************************************************************/
+void ReadInput::Load(int size, char *baseSequence, short *pairRefSequence) {
   char c = toupper(baseSequence[0]);
   int isChar = 0; // flag to detect how the char* input works
 
@@ -290,4 +315,8 @@ int ReadInput::BasePair(int a) { return Sequence[a]; };
 
 /*********************************************************************************
 *********************************************************************************/
-ReadInput::~ReadInput(){};
+ReadInput::~ReadInput() {
+  for (int i = 0; i < MaxN; i++)
+    if (looplists[i] != NULL)
+      delete looplists[i];
+};
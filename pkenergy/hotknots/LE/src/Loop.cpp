@@ -35,6 +35,7 @@ loops and the free energy of the secodary structure.
 #include <math.h>
 
 #include "Loop.h"
+#include "RegionCache.h" // region_energy_cached()
 
 #include "Defines.h" // July 16 - added - includes common.h and commonPK.h
 #include "common.h"
@@ -95,8 +96,22 @@ void Loop::clearLoop(){
 /*********************************************************************************
 *********************************************************************************/
 Loop::~Loop() {
+  // a loop owns its children and the siblings to its left
   if (RightChild != NULL)
     delete RightChild;
+  if (LeftSibling != NULL)
+    delete LeftSibling;
+
+  T_IntList *lists[] = {ILoops, MLoops};
+  for (int k = 0; k < 2; k++) {
+    while (lists[k] != NULL) {
+      T_IntList *next = lists[k]->Next;
+      delete lists[k];
+      lists[k] = next;
+    }
+  }
+
+  delete[] DotParanthStructure;
 }
 
 /********************************************************************************
@@ -201,6 +216,7 @@ void Loop::FindInnerLoops(int border1, int border2) {
               IntList->Num = y;
               IntList->Next = NULL;
               IntList->tuning_flag = 0; // PARAMETER TUNING
+              delete Input->looplists[y];
               Input->looplists[y] = new LoopList(Input, y, x);
               if (DEBUG)
                 printf("Adding %d to ILOOPS\n", y);
@@ -224,6 +240,7 @@ void Loop::FindInnerLoops(int border1, int border2) {
             IntList->Num = y;
             IntList->Next = NULL;
             IntList->tuning_flag = 0; // PARAMETER TUNING
+            delete Input->looplists[y];
             Input->looplists[y] = new LoopList(Input, y, x);
             Input->looplists[y]->FindChildren();
             IntList->Next = MLoops;
@@ -4096,8 +4113,11 @@ double Loop::pkfreeEnergyDP(double **P_matrix, double *c, double &f,
   }
 
   // call SimFold energy/feature counts function
-  double retval = get_feature_counts_restricted(csequence, structure, c, f,
-                                                reset_c, ignore_dangles, 0);
+  double retval =
+      (c == NULL)
+          ? region_energy_cached(csequence, structure, ignore_dangles, 0)
+          : get_feature_counts_restricted(csequence, structure, c, f, reset_c,
+                                          ignore_dangles, 0);
   if (DEBUG)
     printf("--> Energy from simfold get_feature_counts: %f\n", retval);
 
@@ -4409,10 +4429,15 @@ double Loop::nestedPseudoEnergyDP(double **P_matrix, double *c, double &f,
   }
 
   // call SimFold energy/feature counts function
-  float retval = get_feature_counts_restricted(csequence, structure, c, f,
-                                               reset_c, ignore_dangles, 0);
+  float retval =
+      (c == NULL)
+          ? region_energy_cached(csequence, structure, ignore_dangles, 0)
+          : get_feature_counts_restricted(csequence, structure, c, f, reset_c,
+                                          ignore_dangles, 0);
   if (DEBUG)
     printf("--> Energy from simfold get_feature_counts: %f\n", retval);
+  delete[] structure;
+  delete[] csequence;
 
   PARAMTYPE dang = 0; // int, 10cal/mol
   // create pkfree_structure: a string of dot-brackets to represent the region
@@ -4818,6 +4843,10 @@ float Loop::pseudoEnergyDP(double **P_matrix, double *c, double &f, int reset_c,
   T_IntList *L2 = MLoops;
   int a, ap, bp, b;
 
+  // the dirty bits of a previous evaluation of the same tree
+  for (L1 = ILoops; L1 != NULL; L1 = L1->Next)
+    L1->tuning_flag = 0;
+
   float pkfree_retval = 0;
 
   pk_str_features *feat = Input->loops;
@@ -4919,8 +4948,8 @@ float Loop::pseudoEnergyDP(double **P_matrix, double *c, double &f, int reset_c,
                   csequence, structure, c_temp, f_temp, 1, ignore_dangles, 1);
             } else {
               f_temp = 0;
-              pkfree_retval = get_feature_counts_restricted(
-                  csequence, structure, NULL, f_temp, 1, ignore_dangles, 1);
+              pkfree_retval =
+                  region_energy_cached(csequence, structure, ignore_dangles, 1);
             }
 
             if (DEBUG)
@@ -5148,8 +5177,8 @@ float Loop::pseudoEnergyDP(double **P_matrix, double *c, double &f, int reset_c,
             csequence, structure, c_temp, f_temp, 1, ignore_dangles, 1);
       } else {
         f_temp = 0;
-        pkfree_retval = get_feature_counts_restricted(
-            csequence, structure, NULL, f_temp, 1, ignore_dangles, 1);
+        pkfree_retval =
+            region_energy_cached(csequence, structure, ignore_dangles, 1);
       }
 
       if (DEBUG)
@@ -6081,8 +6110,11 @@ double Loop::pkfreeEnergyCC2006b(double **P_matrix, double *c, double &f,
   }
 
   // call SimFold energy/feature counts function
-  double retval = get_feature_counts_restricted(csequence, structure, c, f,
-                                                reset_c, ignore_dangles, 0);
+  double retval =
+      (c == NULL)
+          ? region_energy_cached(csequence, structure, ignore_dangles, 0)
+          : get_feature_counts_restricted(csequence, structure, c, f, reset_c,
+                                          ignore_dangles, 0);
   if (DEBUG)
     printf("--> Energy from simfold get_feature_counts: %f\n", retval);
 
@@ -6201,10 +6233,15 @@ double Loop::nestedPseudoEnergyCC2006b(double **P_matrix, double *c, double &f,
   }
 
   // call SimFold energy/feature counts function
-  float retval = get_feature_counts_restricted(csequence, structure, c, f,
-                                               reset_c, ignore_dangles, 0);
+  float retval =
+      (c == NULL)
+          ? region_energy_cached(csequence, structure, ignore_dangles, 0)
+          : get_feature_counts_restricted(csequence, structure, c, f, reset_c,
+                                          ignore_dangles, 0);
   if (DEBUG)
     printf("--> Energy from simfold get_feature_counts: %f\n", retval);
+  delete[] structure;
+  delete[] csequence;
 
   PARAMTYPE dang = 0; // int, 10cal/mol
   // create pkfree_structure: a string of dot-brackets to represent the region
@@ -7410,8 +7447,8 @@ float Loop::pseudoEnergyCC2006b(double **P_matrix, double *c, double &f,
         pkfree_retval = get_feature_counts_restricted(csequence, structure, c,
                                                       f, 0, ignore_dangles, 1);
       } else {
-        pkfree_retval = get_feature_counts_restricted(
-            csequence, structure, NULL, f, 0, ignore_dangles, 1);
+        pkfree_retval =
+            region_energy_cached(csequence, structure, ignore_dangles, 1);
       }
 
       if (DEBUG)
@@ -0,0 +1,253 @@
+// Author: Angelos Kolaitis
+// Email: neoaggelos@gmail.com
+// Date: 2023-03-20
+// Description: Binary snapshot of the loaded energy parameters, so that
+//              processes can skip parsing the text parameter files.
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ParamSnapshot.h"
+#include "externs.h"   // simfold parameter tables
+#include "externsPK.h" // pseudoknot parameter tables
+
+namespace {
+
+struct Section {
+  const char *name;
+  void *data;
+  size_t size;
+};
+
+// On-disk layout. All integers are in the byte order of the writer, which is
+// checked through byte_order.
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t nsections;
+  uint32_t reserved;
+  uint64_t size; // size of the whole snapshot
+};
+
+struct SectionEntry {
+  char name[48];
+  uint64_t offset; // from the start of the snapshot
+  uint64_t size;
+};
+
+} // namespace
+
+static const char kMagic[8] = {'P', 'K', 'E', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t kByteOrder = 0x01020304;
+
+// sections start on cache line boundaries
+static const uint64_t kAlignment = 64;
+
+#define SECTION(table) {#table, (void *)&(table), sizeof(table)}
+
+// *** Add new parameter tables here, and increase PARAM_SNAPSHOT_VERSION
+static const Section kSections[] = {
+    // energies
+    SECTION(stack),
+    SECTION(tstackh),
+    SECTION(tstacki),
+    SECTION(int11),
+    SECTION(int21),
+    SECTION(int22),
+    SECTION(dangle_top),
+    SECTION(dangle_bot),
+    SECTION(internal_penalty_by_size),
+    SECTION(bulge_penalty_by_size),
+    SECTION(hairpin_penalty_by_size),
+    SECTION(misc),
+#if (MODEL == SIMPLE)
+    SECTION(triloop),
+    SECTION(tloop),
+    SECTION(nb_triloops),
+    SECTION(nb_tloops),
+#elif (MODEL == EXTENDED)
+    SECTION(special_hl),
+    SECTION(nb_special_hl),
+    SECTION(int22mid),
+    SECTION(int22mid_group1),
+    SECTION(int22mid_group2),
+    SECTION(int22mid_group3),
+    SECTION(int22mid_group4),
+    SECTION(int11_experimental_addition),
+    SECTION(int21_experimental_addition),
+    SECTION(internal_penalty_by_size_2D),
+    SECTION(bulgeA),
+    SECTION(bulgeC),
+    SECTION(bulgeG),
+    SECTION(bulgeU),
+    SECTION(bulge1),
+#endif
+
+    // enthalpies
+    SECTION(enthalpy_stack),
+    SECTION(enthalpy_tstackh),
+    SECTION(enthalpy_tstacki),
+    SECTION(enthalpy_int11),
+    SECTION(enthalpy_int21),
+    SECTION(enthalpy_int22),
+    SECTION(enthalpy_dangle_top),
+    SECTION(enthalpy_dangle_bot),
+    SECTION(enthalpy_internal_penalty_by_size),
+    SECTION(enthalpy_bulge_penalty_by_size),
+    SECTION(enthalpy_hairpin_penalty_by_size),
+    SECTION(enthalpy_misc),
+    SECTION(enthalpy_triloop),
+    SECTION(enthalpy_tloop),
+    SECTION(enthalpy_nb_triloops),
+    SECTION(enthalpy_nb_tloops),
+
+    // pseudoknot energy models
+    SECTION(pkmodelDP),
+    SECTION(pkmodelRE),
+    SECTION(pkmodelCC2006),
+    SECTION(cc2006_s2_l1),
+    SECTION(cc2006_s1_l2),
+    SECTION(cc2006_s2_formula),
+    SECTION(cc2006_s1_formula),
+    SECTION(coaxstack_f_a),
+    SECTION(coaxstack_f_b),
+    SECTION(coaxstack_m1),
+    SECTION(coaxstack_m2),
+};
+
+#undef SECTION
+
+static const uint32_t kNumSections = sizeof(kSections) / sizeof(kSections[0]);
+
+static uint64_t align(uint64_t offset) {
+  return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+int param_snapshot_write(const char *path) {
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = PARAM_SNAPSHOT_VERSION;
+  header.byte_order = kByteOrder;
+  header.nsections = kNumSections;
+
+  SectionEntry entries[kNumSections];
+  memset(entries, 0, sizeof(entries));
+  uint64_t offset = align(sizeof(header) + sizeof(entries));
+  for (uint32_t i = 0; i < kNumSections; i++) {
+    strncpy(entries[i].name, kSections[i].name, sizeof(entries[i].name) - 1);
+    entries[i].offset = offset;
+    entries[i].size = kSections[i].size;
+    offset = align(offset + kSections[i].size);
+  }
+  header.size = offset;
+
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "Cannot open parameter snapshot %s for writing\n", path);
+    return -1;
+  }
+
+  static const char padding[kAlignment] = {0};
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(entries, sizeof(entries), 1, file) == 1;
+  uint64_t written = sizeof(header) + sizeof(entries);
+  for (uint32_t i = 0; ok && i < kNumSections; i++) {
+    ok = fwrite(padding, 1, entries[i].offset - written, file) ==
+             entries[i].offset - written &&
+         fwrite(kSections[i].data, kSections[i].size, 1, file) == 1;
+    written = entries[i].offset + entries[i].size;
+  }
+  ok = ok &&
+       fwrite(padding, 1, header.size - written, file) == header.size - written;
+
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Cannot write parameter snapshot %s\n", path);
+    return -1;
+  }
+  return 0;
+}
+
+// Check that a mapped snapshot matches the parameter tables of this library.
+static bool snapshot_valid(const char *data, uint64_t size, const char *path) {
+  if (size < sizeof(Header) + sizeof(SectionEntry) * kNumSections) {
+    fprintf(stderr, "%s: not a parameter snapshot\n", path);
+    return false;
+  }
+
+  const Header *header = (const Header *)data;
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+    fprintf(stderr, "%s: not a parameter snapshot\n", path);
+    return false;
+  }
+  if (header->byte_order != kByteOrder ||
+      header->version != PARAM_SNAPSHOT_VERSION ||
+      header->nsections != kNumSections || header->size != size) {
+    fprintf(stderr, "%s: parameter snapshot version mismatch\n", path);
+    return false;
+  }
+
+  const SectionEntry *entries = (const SectionEntry *)(header + 1);
+  for (uint32_t i = 0; i < kNumSections; i++) {
+    const SectionEntry &entry = entries[i];
+    bool same = entry.size == kSections[i].size &&
+                strncmp(entry.name, kSections[i].name, sizeof(entry.name)) == 0;
+    if (!same || entry.offset > size || entry.size > size - entry.offset) {
+      fprintf(stderr, "%s: parameter snapshot section %s mismatch\n", path,
+              kSections[i].name);
+      return false;
+    }
+  }
+  return true;
+}
+
+int param_snapshot_read(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open parameter snapshot %s\n", path);
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    fprintf(stderr, "%s: not a parameter snapshot\n", path);
+    close(fd);
+    return -1;
+  }
+
+  // the mapping is shared with every other process reading the same snapshot
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Cannot map parameter snapshot %s\n", path);
+    return -1;
+  }
+
+  bool ok = snapshot_valid((const char *)data, st.st_size, path);
+  if (ok) {
+    const SectionEntry *entries =
+        (const SectionEntry *)((const Header *)data + 1);
+    for (uint32_t i = 0; i < kNumSections; i++) {
+      memcpy(kSections[i].data, (const char *)data + entries[i].offset,
+             kSections[i].size);
+    }
+  }
+
+  munmap(data, st.st_size);
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,110 @@
+// Author: Angelos Kolaitis
+// Email: neoaggelos@gmail.com
+// Date: 2023-03-09
+// Description: Per-thread LRU cache for the energies of pseudoknot-free
+//              regions, so that regions shared by many candidate structures
+//              are only parsed and scored by simfold once.
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <atomic>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "RegionCache.h"
+#include "externs.h" // no_dangling_ends
+#include "params.h"  // get_feature_counts_restricted()
+
+// Configuration shared by all threads. It is only written by
+// region_cache_configure(), while no energies are being calculated.
+static int gEntries = 0;
+static unsigned gGeneration = 0;
+
+static std::atomic<long> gHits(0);
+static std::atomic<long> gMisses(0);
+
+namespace {
+
+// LRU cache of a single thread. The most recently used entry is at the front
+// of the list, and the map points to the list entry of each key.
+struct RegionCache {
+  typedef std::list<std::pair<std::string, double>> List;
+
+  List entries;
+  std::unordered_map<std::string, List::iterator> index;
+  unsigned generation = 0;
+
+  void Clear() {
+    entries.clear();
+    index.clear();
+    generation = gGeneration;
+  }
+};
+
+} // namespace
+
+static thread_local RegionCache tCache;
+
+double region_energy_cached(char *sequence, char *structure, int ignore_dangles,
+                            int ignore_first_AU_penalty) {
+  double f = 0;
+  if (gEntries <= 0) {
+    return get_feature_counts_restricted(sequence, structure, NULL, f, 0,
+                                         ignore_dangles,
+                                         ignore_first_AU_penalty);
+  }
+
+  RegionCache &cache = tCache;
+  if (cache.generation != gGeneration) {
+    cache.Clear();
+  }
+
+  std::string key(sequence);
+  key += '/';
+  key += structure;
+  key += ignore_dangles ? '1' : '0';
+  key += ignore_first_AU_penalty ? '1' : '0';
+
+  auto it = cache.index.find(key);
+  if (it != cache.index.end()) {
+    gHits.fetch_add(1, std::memory_order_relaxed);
+    cache.entries.splice(cache.entries.begin(), cache.entries, it->second);
+
+    // get_feature_counts_restricted() also leaves this set for later calls
+    no_dangling_ends = ignore_dangles ? 1 : 0;
+    return it->second->second;
+  }
+
+  gMisses.fetch_add(1, std::memory_order_relaxed);
+  double energy = get_feature_counts_restricted(
+      sequence, structure, NULL, f, 0, ignore_dangles, ignore_first_AU_penalty);
+
+  if ((int)cache.entries.size() >= gEntries) {
+    cache.index.erase(cache.entries.back().first);
+    cache.entries.pop_back();
+  }
+  cache.entries.emplace_front(std::move(key), energy);
+  cache.index[cache.entries.front().first] = cache.entries.begin();
+  return energy;
+}
+
+void region_cache_configure(int entries) {
+  gEntries = entries;
+  gGeneration++;
+  gHits = 0;
+  gMisses = 0;
+}
+
+void region_cache_stats(long *hits, long *misses) {
+  *hits = gHits;
+  *misses = gMisses;
+}
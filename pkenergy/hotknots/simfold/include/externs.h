@@ -33,7 +33,7 @@ extern int ignore_multi;      // for debugging purposes
 extern int fix_dangles;
 extern int simple_internal_energy;
 extern int simple_dangling_ends;
-extern int no_dangling_ends;    // if 1, don't add dangling ends at all
+extern thread_local int no_dangling_ends;    // if 1, don't add dangling ends at all
 extern int max_internal_loop;
 extern int *constraints;
 
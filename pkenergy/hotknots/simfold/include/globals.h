@@ -233,7 +233,7 @@ char * rna_special_hl_energy_par    = par_value[56];
 
 int simple_internal_energy = 0;
 int simple_dangling_ends = 1;     // if 1, don't do minimization in multi-loops and exterior loops, just add the one at the 3' end
-int no_dangling_ends = 0;    // if 1, don't add dangling ends at all
+thread_local int no_dangling_ends = 0;    // if 1, don't add dangling ends at all
 char string_params[MAXNUMPARAMS][MAXPNAME];    // for playing with the parameters
 char string_params_human_readable[MAXNUMPARAMS][MAXPNAME];    // another version of string_params, more human readable
 int num_params;
@@ -36,7 +36,7 @@
 
 // I played with the following functions to study a bit the parameters
 
-int ignore_AU_penalty = 0;
+thread_local int ignore_AU_penalty = 0; // set by get_feature_counts_restricted
 
 void print_stacking_energies()
 // prints the stacking energies
@@ -988,7 +988,7 @@ double count_types(int link, int *sequence, char *csequence, char *structure,
   PARAMTYPE dang;
   PARAMTYPE misc_energy;
   int h, l;
-  static int cannot_add_dangling[MAXSLEN];
+  static thread_local int cannot_add_dangling[MAXSLEN];
   char type[100];
   int index;
 
@@ -1522,7 +1522,7 @@ double count_each_structure_type(char *sequence, char *structure,
     free_value = 0;
   }
 
-  num_params = create_string_params();
+  get_num_params();
   len = strlen(sequence);
   // look for the space
   space = strstr(sequence, " ");
@@ -4357,8 +4357,13 @@ int create_string_params()
   return traverse_features_and_do_work("create_string_params", NULL, NULL);
 }
 
-int get_num_params() {
-  num_params = create_string_params();
+int get_num_params()
+// The parameter names only depend on the options fixed by init_data, so they
+// are created on the first call only. Afterwards string_params is read-only,
+// and can be used from several threads.
+{
+  if (num_params == 0)
+    num_params = create_string_params();
   return num_params;
 }
 
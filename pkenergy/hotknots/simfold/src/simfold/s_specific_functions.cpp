@@ -350,7 +350,7 @@ PARAMTYPE s_calculate_energy(int *sequence, char *csequence, char *structure,
   PARAMTYPE dang;
   PARAMTYPE misc_energy;
   int h, l, nb_nucleotides;
-  static int cannot_add_dangling[MAXSLEN];
+  static thread_local int cannot_add_dangling[MAXSLEN];
   int *ptable_restricted = NULL;
 
   nb_nucleotides = strlen(csequence);
@@ -539,7 +539,7 @@ PARAMTYPE s_calculate_enthalpy(int *sequence, char *csequence, str_features *f)
   PARAMTYPE dang;
   PARAMTYPE misc_energy;
   int h, l, nb_nucleotides;
-  static int cannot_add_dangling[MAXSLEN];
+  static thread_local int cannot_add_dangling[MAXSLEN];
 
   nb_nucleotides = strlen(csequence);
   for (i = 0; i < nb_nucleotides; i++)
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+#
+# Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+"""
+Script:         08-benchmark-parser-windows.py
+Usage:          ./scripts/08-benchmark-parser-windows.py cases/new.yaml \
+                    --library before=./libpseudoknot-old.so \
+                    --library after=./libpseudoknot.so > out.csv
+Description:
+    Measure the cost of the YAEP pseudoknot parser per parsed window. Each
+    library is loaded in a separate process, so that two builds of the same
+    library (e.g. before and after a change) can be compared side by side.
+
+    The output is a CSV with one row per (library, case). A summary line per
+    library, with the total number of windows, the total time and the average
+    cost per window in microseconds, is printed to stderr.
+"""
+
+import argparse
+import concurrent.futures
+import sys
+import time
+
+import pandas as pd
+import yaml
+
+from knotify.parsers.yaep import YaepParser
+
+
+def count_windows(length: int, args: argparse.Namespace) -> int:
+    """
+    Number of (left, right) windows that the parser will attempt to parse. This
+    must match the window loops in parsers/pseudoknot.c
+    """
+    min_window_size = args.min_window_size or int(length * args.min_window_size_ratio)
+    max_window_size = args.max_window_size or int(length * args.max_window_size_ratio)
+
+    windows = 0
+    for right in range(length - 1, min_window_size - 2, -1):
+        left = right - min_window_size + 1
+        lowest = max(right - max_window_size + 1, 0)
+        windows += max(left - lowest + 1, 0)
+
+    return windows
+
+
+def run_library(name: str, library: str, cases: list, args: argparse.Namespace):
+    parser = YaepParser(
+        library_path=library,
+        max_dd_size=args.max_dd_size,
+        allow_ug=args.allow_ug,
+        min_window_size=args.min_window_size,
+        max_window_size=args.max_window_size,
+        min_window_size_ratio=args.min_window_size_ratio,
+        max_window_size_ratio=args.max_window_size_ratio,
+        threads=args.threads,
+    )
+
+    records = []
+    for idx, case in enumerate(cases):
+        sequence = case["case"].lower()
+        windows = count_windows(len(sequence), args)
+
+        start = time.monotonic()
+        results = parser.detect_pseudoknots(sequence)
+        duration = time.monotonic() - start
+
+        records.append(
+            {
+                "library": name,
+                "case": idx,
+                "length": len(sequence),
+                "windows": windows,
+                "results": len(results),
+                "duration": duration,
+                "usec_per_window": duration * 1e6 / max(windows, 1),
+            }
+        )
+
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("cases")
+    parser.add_argument(
+        "--library",
+        action="append",
+        default=[],
+        help="[name=]path to a libpseudoknot.so build, can be repeated",
+    )
+    parser.add_argument("--max-dd-size", type=int, default=2)
+    parser.add_argument("--allow-ug", action="store_true")
+    parser.add_argument("--min-window-size", type=int, default=6)
+    parser.add_argument("--max-window-size", type=int, default=204)
+    parser.add_argument("--min-window-size-ratio", type=float, default=0)
+    parser.add_argument("--max-window-size-ratio", type=float, default=0)
+    parser.add_argument("--threads", type=int, default=1)
+
+    args = parser.parse_args()
+
+    with open(args.cases, "r") as fin:
+        cases = yaml.safe_load(fin.read())
+
+    records = []
+    for library in args.library or ["./libpseudoknot.so"]:
+        name, _, path = library.rpartition("=")
+        name = name or path
+
+        # use a fresh process for each library, so that builds do not clash
+        with concurrent.futures.ProcessPoolExecutor(max_workers=1) as executor:
+            result = executor.submit(run_library, name, path, cases, args).result()
+
+        windows = sum(r["windows"] for r in result)
+        duration = sum(r["duration"] for r in result)
+        print(
+            "{}: {} windows, {:.2f} sec, {:.3f} usec/window".format(
+                name, windows, duration, duration * 1e6 / max(windows, 1)
+            ),
+            file=sys.stderr,
+        )
+        records.extend(result)
+
+    pd.DataFrame(records).to_csv(sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
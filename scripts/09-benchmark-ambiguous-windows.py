@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#
+# Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+"""
+Script:         09-benchmark-ambiguous-windows.py
+Usage:          ./scripts/09-benchmark-ambiguous-windows.py \
+                    --library before=./libpseudoknot-old.so \
+                    --library after=./libpseudoknot.so \
+                    --max-dd-size 6 --allow-ug > out.csv
+Description:
+    Microbenchmark for the parse tree traversal of the YAEP pseudoknot parser.
+    Every window of a sequence is parsed on its own, with a window size equal
+    to the sequence length, so each call parses exactly one window.
+
+    Sequences are drawn randomly from a small alphabet (by default "gu"), where
+    almost every nucleotide can pair with every other when GU pairs are allowed.
+    Such windows have a very large number of (left loop, dd) parses, which
+    makes them a worst case for collecting candidates from the parse tree.
+
+    The output is a CSV with one row per (library, length). A summary line per
+    library, with the total number of windows and core stems, the total time
+    and the average cost per window in microseconds, is printed to stderr.
+"""
+
+import argparse
+import concurrent.futures
+import random
+import sys
+import time
+
+import pandas as pd
+
+from knotify.parsers.yaep import YaepParser
+
+
+def generate_windows(args: argparse.Namespace) -> list:
+    rng = random.Random(args.seed)
+    return [
+        (
+            length,
+            "".join(rng.choice(args.alphabet) for _ in range(length)),
+        )
+        for length in args.lengths
+        for _ in range(args.count)
+    ]
+
+
+def run_library(name: str, library: str, windows: list, args: argparse.Namespace):
+    records = []
+    for length in args.lengths:
+        parser = YaepParser(
+            library_path=library,
+            max_dd_size=args.max_dd_size,
+            allow_ug=args.allow_ug,
+            min_window_size=length,
+            max_window_size=length,
+        )
+
+        sequences = [sequence for (size, sequence) in windows if size == length]
+        results = 0
+        start = time.monotonic()
+        for sequence in sequences:
+            results += len(parser.detect_pseudoknots(sequence))
+        duration = time.monotonic() - start
+
+        records.append(
+            {
+                "library": name,
+                "length": length,
+                "windows": len(sequences),
+                "results": results,
+                "duration": duration,
+                "usec_per_window": duration * 1e6 / max(len(sequences), 1),
+            }
+        )
+
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--library",
+        action="append",
+        default=[],
+        help="[name=]path to a libpseudoknot.so build, can be repeated",
+    )
+    parser.add_argument(
+        "--lengths", type=int, nargs="+", default=[20, 40, 60, 80, 100, 150]
+    )
+    parser.add_argument("--count", type=int, default=100)
+    parser.add_argument("--alphabet", default="gu")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--max-dd-size", type=int, default=6)
+    parser.add_argument("--allow-ug", action="store_true")
+
+    args = parser.parse_args()
+
+    windows = generate_windows(args)
+
+    records = []
+    for library in args.library or ["./libpseudoknot.so"]:
+        name, _, path = library.rpartition("=")
+        name = name or path
+
+        # use a fresh process for each library, so that builds do not clash
+        with concurrent.futures.ProcessPoolExecutor(max_workers=1) as executor:
+            result = executor.submit(run_library, name, path, windows, args).result()
+
+        count = sum(r["windows"] for r in result)
+        results = sum(r["results"] for r in result)
+        duration = sum(r["duration"] for r in result)
+        print(
+            "{}: {} windows, {} core stems, {:.2f} sec, {:.3f} usec/window".format(
+                name, count, results, duration, duration * 1e6 / max(count, 1)
+            ),
+            file=sys.stderr,
+        )
+        records.extend(result)
+
+    pd.DataFrame(records).to_csv(sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
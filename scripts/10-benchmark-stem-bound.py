@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+#
+# Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+"""
+Script:         10-benchmark-stem-bound.py
+Usage:          ./scripts/10-benchmark-stem-bound.py cases/new.yaml \
+                    --parser span --library ./libspan.so > out.csv
+Description:
+    Measure how many windows and core stems are skipped by the parser stem
+    bound (see include/stembound.h), and how much faster the parser and the
+    knotify candidate generation become. Each case is processed once without
+    and once with the stem bound, and the results are checked to be the same.
+
+    Energy is replaced with a trivial function, since it is only evaluated for
+    results that pass the stems criterion, which are the same in both runs.
+
+    The output is a CSV with one row per case. A summary is printed to stderr,
+    with the number of windows and core stems skipped, and the parser and
+    knotify times without and with the stem bound.
+"""
+
+import argparse
+import sys
+import time
+
+import pandas as pd
+import yaml
+
+from knotify.algorithm.knotify import Knotify
+from knotify.energy.base import BaseEnergy
+from knotify.pairalign.bulges import BulgesPairAlign
+from knotify.pairalign.cpairalign import CPairAlign
+from knotify.parsers.bruteforce import BruteForceParser
+from knotify.parsers.span import SpanParser
+from knotify.parsers.yaep import YaepParser
+
+PARSERS = {
+    "yaep": (YaepParser, "./libpseudoknot.so"),
+    "bruteforce": (BruteForceParser, "./libbruteforce.so"),
+    "span": (SpanParser, "./libspan.so"),
+}
+
+
+class StemsEnergy(BaseEnergy):
+    def eval(self, sequence: str, dot_bracket: str) -> float:
+        return -dot_bracket.count("(") - dot_bracket.count("[")
+
+
+def run(sequence: str, parser, config: dict):
+    start = time.monotonic()
+    core_stems = parser.detect_pseudoknots(sequence)
+    parser_duration = time.monotonic() - start
+
+    start = time.monotonic()
+    data = Knotify().get_results(sequence, parser.detect_pseudoknots, **config)
+    knotify_duration = time.monotonic() - start
+
+    return len(core_stems), parser_duration, knotify_duration, data
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("cases")
+    parser.add_argument("--parser", choices=PARSERS.keys(), default="span")
+    parser.add_argument("--library", default=None)
+    parser.add_argument("--max-dd-size", type=int, default=2)
+    parser.add_argument("--allow-ug", action="store_true")
+    parser.add_argument("--max-window-size", type=int, default=100)
+    parser.add_argument("--max-stem-allow-smaller", type=int, default=1)
+    parser.add_argument("--bulges", action="store_true")
+    parser.add_argument("--bulges-library-path", default="./libbulges.so")
+    parser.add_argument(
+        "--consecutive-pairalign-library-path", default="./libcpairalign.so"
+    )
+
+    args = parser.parse_args()
+
+    with open(args.cases, "r") as fin:
+        cases = yaml.safe_load(fin.read())
+
+    parser_class, library = PARSERS[args.parser]
+    parser_args = {
+        "library_path": args.library or library,
+        "max_dd_size": args.max_dd_size,
+        "allow_ug": args.allow_ug,
+        "max_window_size": args.max_window_size,
+    }
+
+    pairalign = [CPairAlign(args.consecutive_pairalign_library_path).pairalign]
+    if args.bulges:
+        pairalign.append(
+            BulgesPairAlign(1, 1, True, False, args.bulges_library_path).pairalign
+        )
+    config = {
+        "pairalign": pairalign,
+        "max_stem_allow_smaller": args.max_stem_allow_smaller,
+        "prune_early": True,
+        "energy": StemsEnergy(),
+    }
+    columns = ["dot_bracket", "stems", "dd", "energy"]
+
+    records = []
+    for idx, case in enumerate(cases):
+        sequence = case["case"].lower()
+
+        p = parser_class(**parser_args)
+        before = run(sequence, p, config)
+
+        p = parser_class(stem_bound=args.max_stem_allow_smaller, **parser_args)
+        after = run(sequence, p, config)
+
+        # stats are reset with every parser, and cover both parses of the case
+        stats = {k: v // 2 for (k, v) in p.get_stem_bound_stats().items()}
+
+        records.append(
+            {
+                "case": idx,
+                "length": len(sequence),
+                "core_stems_before": before[0],
+                "core_stems_after": after[0],
+                **stats,
+                "parser_duration_before": before[1],
+                "parser_duration_after": after[1],
+                "knotify_duration_before": before[2],
+                "knotify_duration_after": after[2],
+                "same_results": before[3][columns].equals(after[3][columns]),
+            }
+        )
+
+    df = pd.DataFrame(records)
+    windows, windows_skipped = df["windows"].sum(), df["windows_skipped"].sum()
+    core_stems, skipped = df["core_stems"].sum(), df["core_stems_skipped"].sum()
+    print(
+        "{}: {}/{} windows skipped ({:.2f}%), "
+        "{}/{} core stems skipped ({:.2f}%)".format(
+            args.parser,
+            windows_skipped,
+            windows,
+            100 * windows_skipped / max(windows, 1),
+            skipped,
+            core_stems,
+            100 * skipped / max(core_stems, 1),
+        ),
+        file=sys.stderr,
+    )
+    for stage in ["parser", "knotify"]:
+        before = df["{}_duration_before".format(stage)].sum()
+        after = df["{}_duration_after".format(stage)].sum()
+        print(
+            "{}: {} {:.2f} sec -> {:.2f} sec ({:.2f}x)".format(
+                args.parser, stage, before, after, before / max(after, 1e-9)
+            ),
+            file=sys.stderr,
+        )
+    if not df["same_results"].all():
+        print("{}: results differ!".format(args.parser), file=sys.stderr)
+
+    df.to_csv(sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
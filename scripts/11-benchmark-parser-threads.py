@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+#
+# Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+"""
+Script:         11-benchmark-parser-threads.py
+Usage:          ./scripts/11-benchmark-parser-threads.py cases/new.yaml \
+                    --parser bruteforce --max-threads 8 > out.csv
+Description:
+    Measure how the parser scales with the number of threads (--parser-threads).
+    All cases are parsed once for every number of threads from 1 to
+    --max-threads (the number of cores by default), and the results are checked
+    to be the same as with a single thread.
+
+    The output is a CSV with one row per number of threads. A summary line per
+    number of threads, with the total time and the speedup over a single
+    thread, is printed to stderr.
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import pandas as pd
+import yaml
+
+from knotify.parsers.bruteforce import BruteForceParser
+from knotify.parsers.span import SpanParser
+from knotify.parsers.yaep import YaepParser
+
+PARSERS = {
+    "yaep": (YaepParser, "./libpseudoknot.so"),
+    "bruteforce": (BruteForceParser, "./libbruteforce.so"),
+    "span": (SpanParser, "./libspan.so"),
+}
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("cases")
+    parser.add_argument("--parser", choices=PARSERS.keys(), default="bruteforce")
+    parser.add_argument("--library", default=None)
+    parser.add_argument("--max-threads", type=int, default=os.cpu_count())
+    parser.add_argument("--repeat", type=int, default=1)
+    parser.add_argument("--max-dd-size", type=int, default=2)
+    parser.add_argument("--allow-ug", action="store_true")
+    parser.add_argument("--max-window-size", type=int, default=100)
+
+    args = parser.parse_args()
+
+    with open(args.cases, "r") as fin:
+        sequences = [case["case"] for case in yaml.safe_load(fin.read())]
+
+    parser_class, library = PARSERS[args.parser]
+
+    records = []
+    expected = None
+    for threads in range(1, args.max_threads + 1):
+        p = parser_class(
+            library_path=args.library or library,
+            max_dd_size=args.max_dd_size,
+            allow_ug=args.allow_ug,
+            max_window_size=args.max_window_size,
+            threads=threads,
+        )
+
+        start = time.monotonic()
+        for _ in range(args.repeat):
+            results = [p.detect_pseudoknots_packed(s).tolist() for s in sequences]
+        duration = time.monotonic() - start
+
+        if expected is None:
+            expected = results
+
+        records.append(
+            {
+                "threads": threads,
+                "duration": duration,
+                "speedup": records[0]["duration"] / duration if records else 1,
+                "core_stems": sum(len(r) for r in results),
+                "same_results": results == expected,
+            }
+        )
+        print(
+            "{}: {} threads, {:.2f} sec, {:.2f}x{}".format(
+                args.parser,
+                threads,
+                duration,
+                records[-1]["speedup"],
+                "" if records[-1]["same_results"] else " (results differ!)",
+            ),
+            file=sys.stderr,
+        )
+
+    pd.DataFrame(records).to_csv(sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,41 @@
+#
+# Copyright © 2022 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+import pytest
+
+from knotify.pairalign.bulges import BulgesPairAlign
+from knotify.pairalign.cpairalign import CPairAlign
+from tests.utils import BULGES, CPAIRALIGN
+
+
+@pytest.fixture
+def pairalign(request):
+    """
+    Create the pairalign of a test right before it runs, see for_each_pairalign().
+
+    The bulges library keeps its configuration in globals, so it must be
+    configured by the test that uses it, never when a module is imported.
+    """
+    name, kwargs = request.param
+    if name == "consecutive":
+        return CPairAlign(CPAIRALIGN)
+    return BulgesPairAlign(library_path=BULGES, **kwargs)
@@ -29,7 +29,7 @@ from knotify import knotify
 HAIRPIN = os.getenv("HAIRPIN_SO", "./libhairpin.so")
 
 
-@pytest.mark.parametrize("parser", ["bruteforce", "yaep"])
+@pytest.mark.parametrize("parser", ["bruteforce", "yaep", "span"])
 @pytest.mark.parametrize(
     "name, sequence, expected, config",
     [
@@ -26,7 +26,7 @@ import pytest
 from knotify import knotify
 
 
-@pytest.mark.parametrize("parser", ["bruteforce", "yaep"])
+@pytest.mark.parametrize("parser", ["bruteforce", "yaep", "span"])
 @pytest.mark.parametrize(
     "name, sequence, candidate, overrides",
     [
@@ -0,0 +1,77 @@
+#
+# Copyright © 2023 Christos Pavlatos, George Rassias, Christos Andrikos,
+#                  Evangelos Makris, Aggelos Kolaitis
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of
+# this software and associated documentation files (the “Software”), to deal in
+# the Software without restriction, including without limitation the rights to
+# use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+# of the Software, and to permit persons to whom the Software is furnished to do
+# so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+import pytest
+import yaml
+
+from knotify.algorithm.knotify import Knotify
+from knotify.energy.base import BaseEnergy
+from knotify.pairalign.bulges import BulgesPairAlign
+from knotify.pairalign.cpairalign import CPairAlign
+from tests.utils import for_each_parser, BULGES, CPAIRALIGN
+
+
+class StemsEnergy(BaseEnergy):
+    """
+    Cheap deterministic energy, so that get_results() can be compared quickly.
+    """
+
+    def eval(self, sequence: str, dot_bracket: str) -> float:
+        return -dot_bracket.count("(") - 0.5 * dot_bracket.count("[")
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("cases", ["cases/cases.yaml"])
+@pytest.mark.parametrize(
+    "max_stem_allow_smaller, allow_skip_final_au", [(0, False), (1, True)]
+)
+def test_stem_bound(
+    parser,
+    library_path: str,
+    cases: str,
+    max_stem_allow_smaller: int,
+    allow_skip_final_au: bool,
+):
+    with open(cases) as fin:
+        sequences = [case["case"] for case in yaml.safe_load(fin)]
+
+    args = {"library_path": library_path, "max_dd_size": 2, "allow_ug": True}
+    config = {
+        "pairalign": [
+            CPairAlign(CPAIRALIGN).pairalign,
+            BulgesPairAlign(1, 1, True, False, BULGES).pairalign,
+        ],
+        "allow_skip_final_au": allow_skip_final_au,
+        "max_stem_allow_smaller": max_stem_allow_smaller,
+        "prune_early": True,
+        "energy": StemsEnergy(),
+    }
+    columns = ["dot_bracket", "stems", "real_stems", "dd", "energy"]
+
+    for sequence in sequences:
+        p = parser(**args)
+        expected = Knotify().get_results(sequence, p.detect_pseudoknots, **config)
+
+        p = parser(stem_bound=max_stem_allow_smaller, **args)
+        result = Knotify().get_results(sequence, p.detect_pseudoknots, **config)
+
+        assert result[columns].equals(expected[columns])
@@ -21,8 +21,11 @@
 # SOFTWARE.
 #
 import pytest
+import yaml
 
 from knotify.pairalign.bulges import BulgesPairAlign
+from knotify.parsers.span import SpanParser
+from tests.utils import SPAN
 
 BULGES_SO = "./libbulges.so"
 
@@ -133,3 +136,41 @@ def test_bulges(name, sequence, core_stems, config, results):
     cfg.update(config)
 
     assert BulgesPairAlign(**cfg).pairalign(sequence, *core_stems) == results
+
+
+@pytest.fixture
+def restore_config():
+    yield
+
+    # reset the bulges library to the defaults used by test_bulges, so that later
+    # tests are not affected (see tests/conftest.py)
+    BulgesPairAlign(1, 1, True, True, BULGES_SO)
+
+
+@pytest.mark.usefixtures("restore_config")
+@pytest.mark.parametrize("cases", ["cases/bulges.yaml"])
+@pytest.mark.parametrize(
+    "config",
+    [
+        {"max_bulge_size": 1, "min_stems_after_bulge": 1, "symmetric_bulges": True},
+        {"max_bulge_size": 3, "min_stems_after_bulge": 2, "symmetric_bulges": True},
+        {"max_bulge_size": 4, "min_stems_after_bulge": 1, "symmetric_bulges": False},
+        {"max_bulge_size": 8, "min_stems_after_bulge": 3, "symmetric_bulges": False},
+    ],
+)
+def test_same_results_as_legacy(cases, config):
+    with open(cases) as fin:
+        sequences = [case["case"].lower() for case in yaml.safe_load(fin)]
+
+    cfg = {"library_path": BULGES_SO, "count_stems_from_bulges": True, **config}
+    parser = SpanParser(SPAN, max_dd_size=2, allow_ug=True)
+    for sequence in sequences:
+        core_stems = parser.detect_pseudoknots_packed(sequence)
+
+        rows, dot_brackets = BulgesPairAlign(
+            legacy_find_bulge=True, **cfg
+        ).pairalign_many(sequence, core_stems)
+        expected = (rows.tolist(), dot_brackets.tolist())
+
+        rows, dot_brackets = BulgesPairAlign(**cfg).pairalign_many(sequence, core_stems)
+        assert (rows.tolist(), dot_brackets.tolist()) == expected
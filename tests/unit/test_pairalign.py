@@ -20,27 +20,30 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 #
+import ctypes
+
+import numpy as np
 import pytest
-from knotify.pairalign.bulges import BulgesPairAlign
+from knotify.pairalign.base import BasePairAlign, CANDIDATE, CANDIDATE_FIELDS
 from knotify.pairalign.cpairalign import CPairAlign
+from knotify.pairalign.ctypes import CALLBACK
+from knotify.parsers.span import SpanParser
+from tests.utils import CPAIRALIGN, SPAN, for_each_pairalign
 
 
-CPAIRALIGN_SO = "./libcpairalign.so"
-BULGES_SO = "./libbulges.so"
+# sequences shared by the tests below
+SEQUENCES = [
+    "acgugaaggcuacgauagugccag",
+    "gcguggaagcccugccugggguugaagcguuaaaacuuaaucaggc",
+    "GGGAAACGAGCCAAGUGGCGCCGACCACUUAAAAACACCGGAA",
+]
 
 
-@pytest.mark.parametrize(
-    "pairalign",
-    [
-        CPairAlign(CPAIRALIGN_SO),
-        BulgesPairAlign(
-            max_bulge_size=0,
-            min_stems_after_bulge=0,
-            symmetric_bulges=True,
-            count_stems_from_bulges=False,
-            library_path=BULGES_SO,
-        ),
-    ],
+@for_each_pairalign(
+    max_bulge_size=0,
+    min_stems_after_bulge=0,
+    symmetric_bulges=True,
+    count_stems_from_bulges=False,
 )
 @pytest.mark.parametrize(
     "sequence,core_stems,expected",
@@ -70,3 +73,151 @@ BULGES_SO = "./libbulges.so"
 )
 def test_pairalign(pairalign, sequence, core_stems, expected):
     assert pairalign.pairalign(sequence, *core_stems) == [expected]
+
+
+@for_each_pairalign()
+@pytest.mark.parametrize("sequence", SEQUENCES)
+def test_pairalign_many(pairalign, sequence):
+    core_stems = SpanParser(SPAN, max_dd_size=2).detect_pseudoknots_packed(sequence)
+
+    expected = []
+    for idx, core_stem in enumerate(core_stems.tolist()):
+        for (dot_bracket, left, right) in pairalign.pairalign(sequence, *core_stem):
+            expected.append((idx, dot_bracket, left, right))
+
+    rows, dot_brackets = pairalign.pairalign_many(sequence, core_stems)
+    assert len(rows) == len(dot_brackets) == len(expected)
+    assert [
+        (idx, dot_bracket.decode(), left, right)
+        for ((idx, left, right), dot_bracket) in zip(rows.tolist(), dot_brackets)
+    ] == expected
+
+
+@for_each_pairalign()
+@pytest.mark.parametrize("sequence", SEQUENCES)
+def test_pairalign_candidates(pairalign, sequence):
+    core_stems = SpanParser(SPAN, max_dd_size=2).detect_pseudoknots_packed(sequence)
+    rows, dot_brackets = pairalign.pairalign_many(sequence, core_stems)
+
+    candidates = pairalign.pairalign_candidates(sequence, core_stems)
+    assert candidates.shape == (len(rows), len(CANDIDATE_FIELDS))
+    assert candidates[:, :3].tolist() == rows.tolist()
+
+    # core stem of each candidate
+    columns = [CANDIDATE[name] for name in ["i", "j", "left_loop_size", "dd_size"]]
+    assert candidates[:, columns].tolist() == core_stems[rows[:, 0]].tolist()
+
+    # render all candidates, and in a different order
+    rendered = pairalign.render_candidates(sequence, candidates)
+    assert rendered.tolist() == dot_brackets.tolist()
+    rendered = pairalign.render_candidates(sequence, candidates[::-1])
+    assert rendered.tolist() == dot_brackets[::-1].tolist()
+
+    assert pairalign.render_candidates(sequence, candidates[:0]).tolist() == []
+
+
+class PairAlignOnly(BasePairAlign):
+    """
+    Only implements pairalign(), so that the fallbacks of BasePairAlign are used.
+    """
+
+    def __init__(self, pairalign: BasePairAlign):
+        self.pairalign = pairalign.pairalign
+
+
+@for_each_pairalign(min_stems_after_bulge=1)
+@pytest.mark.parametrize("skip_final_au", [False, True])
+@pytest.mark.parametrize("sequence", SEQUENCES)
+def test_pairalign_candidates_fallback(pairalign, sequence, skip_final_au):
+    core_stems = SpanParser(SPAN, max_dd_size=2).detect_pseudoknots_packed(sequence)
+    fallback = PairAlignOnly(pairalign)
+
+    expected = pairalign.pairalign_candidates(sequence, core_stems, skip_final_au)
+    candidates = fallback.pairalign_candidates(sequence, core_stems, skip_final_au)
+    columns = [
+        CANDIDATE[name]
+        for name in CANDIDATE_FIELDS
+        if name not in ["left_stems", "right_stems"] and "bulge" not in name
+    ]
+    assert candidates[:, columns].tolist() == expected[:, columns].tolist()
+
+    rendered = fallback.render_candidates(sequence, candidates[::-1])
+    assert (
+        rendered.tolist()
+        == pairalign.render_candidates(sequence, expected[::-1]).tolist()
+    )
+
+    # candidates with the same index have the same dot bracket, also when compared
+    # with the candidates of another pairalign
+    dot_brackets = np.concatenate(
+        [
+            fallback.render_candidates(sequence, candidates),
+            pairalign.render_candidates(sequence, expected),
+        ]
+    )
+    first = fallback.dedup_candidates(np.concatenate([candidates, expected]))
+    assert dot_brackets[first].tolist() == dot_brackets.tolist()
+
+    # candidates of another pairalign cannot be rendered
+    if len(expected):
+        with pytest.raises(ValueError):
+            fallback.render_candidates(sequence, expected)
+
+
+@for_each_pairalign(min_stems_after_bulge=1)
+@pytest.mark.parametrize("sequence", SEQUENCES)
+def test_dedup_candidates(pairalign, sequence):
+    core_stems = SpanParser(SPAN, max_dd_size=2).detect_pseudoknots_packed(sequence)
+
+    # variants without the final AU pairs often have the same dot bracket as
+    # other candidates, candidates of two pairaligns are compared too
+    candidates = pairalign.pairalign_candidates(sequence, core_stems, True)
+    candidates = np.concatenate(
+        [
+            candidates,
+            CPairAlign(CPAIRALIGN).pairalign_candidates(sequence, core_stems),
+        ]
+    )
+    dot_brackets = pairalign.render_candidates(sequence, candidates).tolist()
+
+    first = {}
+    expected = [first.setdefault(d, idx) for (idx, d) in enumerate(dot_brackets)]
+    assert len(first) < len(dot_brackets)
+
+    assert pairalign.dedup_candidates(candidates).tolist() == expected
+    assert BasePairAlign.dedup_candidates(pairalign, candidates).tolist() == expected
+    assert pairalign.dedup_candidates(candidates[:0]).tolist() == []
+
+
+@for_each_pairalign()
+def test_pairalign_prepared(pairalign):
+    sequences = SEQUENCES[:2]
+    core_stems = [
+        SpanParser(SPAN, max_dd_size=2).detect_pseudoknots(sequence)
+        for sequence in sequences
+    ]
+
+    # alternate between sequences, so that cached sequences are replaced
+    expected = [
+        [pairalign.pairalign(sequence, *core_stem) for core_stem in stems]
+        for (sequence, stems) in zip(sequences, core_stems)
+    ]
+    assert expected == [
+        [pairalign.pairalign(sequence, *core_stem) for core_stem in stems]
+        for (sequence, stems) in zip(sequences, core_stems)
+    ]
+
+    lib = pairalign.lib
+    lib.pairalign_prepare.restype = ctypes.c_void_p
+    handles = [lib.pairalign_prepare(sequence.encode()) for sequence in sequences]
+    for (handle, stems, results) in zip(handles, core_stems, expected):
+        for (core_stem, result) in zip(stems, results):
+            out = []
+            lib.pairalign_prepared(
+                ctypes.c_void_p(handle),
+                *core_stem,
+                CALLBACK(lambda d, left, right: out.append((d.decode(), left, right))),
+            )
+            assert out == result
+    for handle in handles:
+        lib.pairalign_release(ctypes.c_void_p(handle))
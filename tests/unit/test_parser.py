@@ -24,9 +24,16 @@ import os
 from typing import Dict, List
 import itertools
 
+import numpy as np
 import pytest
+import yaml
 
-from tests.utils import for_each_parser
+from knotify.pairalign.base import CANDIDATE
+from knotify.pairalign.cpairalign import CPairAlign
+from knotify.parsers.bruteforce import BruteForceParser
+from knotify.parsers.ctypes import CALLBACK
+from knotify.parsers.span import SpanParser
+from tests.utils import for_each_parser, CPAIRALIGN, SPAN
 
 
 @for_each_parser("parser, library_path")
@@ -101,3 +108,145 @@ def test_window_size(
 ):
     p = parser(library_path=library_path, max_dd_size=3, allow_ug=False, **args)
     assert p.detect_pseudoknots(sequence) == result
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("cases", ["cases/cases.yaml", "cases/hairpins.yaml"])
+@pytest.mark.parametrize(
+    "args",
+    [
+        {"max_dd_size": 2, "allow_ug": False},
+        {"max_dd_size": 3, "min_dd_size": 1, "allow_ug": True},
+    ],
+)
+def test_same_results_as_span(parser, library_path: str, cases: str, args: Dict):
+    with open(cases) as fin:
+        sequences = [case["case"] for case in yaml.safe_load(fin)]
+
+    p = parser(library_path=library_path, **args)
+    span = SpanParser(library_path=SPAN, **args)
+    for sequence in sequences:
+        result = span.detect_pseudoknots(sequence)
+        assert len(result) == len(set(result))
+        if parser is BruteForceParser:
+            assert set(p.detect_pseudoknots(sequence)) == set(result)
+        else:
+            # prune_early in get_results() depends on the order of the results
+            assert list(p.detect_pseudoknots(sequence)) == list(result)
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("length", [255, 256, 400])
+def test_long_sequence(parser, library_path: str, length: int):
+    # positions past 255 must not wrap around
+    sequence = ("GGGAAAUGGACUGAGCGGCGCCGACCGCCAAACAACCGGCA" * 10)[:length]
+    args = {"max_dd_size": 2, "allow_ug": True, "max_window_size": 60}
+
+    result = parser(library_path=library_path, **args).detect_pseudoknots(sequence)
+    expected = SpanParser(library_path=SPAN, **args).detect_pseudoknots(sequence)
+    assert set(result) == set(expected)
+    assert max(left + size for (left, size, _, _) in result) == length
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("threads", [2, 3, 8])
+@pytest.mark.parametrize(
+    "sequence",
+    [
+        "GGGAAAUGGACUGAGCGGCGCCGACCGCCAAACAACCGGCA",
+        "ACGUGAAGGCUACGAUAGUGCCAG",
+        "AUCCUUUUCAGUUGGGCCUUCUGGUGAUGUUUCUGGCCACCCAGGAGGUCCUGAGGAAGAGGUGGACGGCC",
+    ],
+)
+def test_threads(parser, library_path: str, threads: int, sequence: str):
+    args = {"library_path": library_path, "max_dd_size": 2, "allow_ug": True}
+    expected = parser(**args).detect_pseudoknots(sequence)
+    result = parser(threads=threads, **args).detect_pseudoknots(sequence)
+    assert result == expected
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("threads", [1, 3])
+@pytest.mark.parametrize(
+    "sequence",
+    [
+        "",
+        "GGGAAAUGGACUGAGCGGCGCCGACCGCCAAACAACCGGCA",
+        "AUCCUUUUCAGUUGGGCCUUCUGGUGAUGUUUCUGGCCACCCAGGAGGUCCUGAGGAAGAGGUGGACGGCC",
+    ],
+)
+def test_packed(parser, library_path: str, threads: int, sequence: str):
+    p = parser(library_path=library_path, max_dd_size=2, allow_ug=True)
+
+    expected = []
+    p.lib.detect_pseudoknots(
+        sequence.lower().encode(), CALLBACK(lambda *row: expected.append(row))
+    )
+
+    p.threads = threads
+    result = p.detect_pseudoknots_packed(sequence)
+    assert result.dtype == "int32"
+    assert result.shape == (len(expected), 4)
+    assert list(map(tuple, result.tolist())) == expected
+    assert p.detect_pseudoknots(sequence) == expected
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("cases", ["cases/cases.yaml"])
+def test_detect_pseudoknots_many(parser, library_path: str, cases: str):
+    with open(cases) as fin:
+        sequences = [case["case"] for case in yaml.safe_load(fin)]
+
+    # include empty sequences and sequences without any results
+    sequences = ["", "aaaa"] + sequences + [""]
+
+    p = parser(library_path=library_path, max_dd_size=2, allow_ug=True)
+    expected = [p.detect_pseudoknots(sequence) for sequence in sequences]
+    assert p.detect_pseudoknots_many(sequences) == expected
+    assert p.detect_pseudoknots_many([]) == []
+
+
+@for_each_parser("parser, library_path")
+@pytest.mark.parametrize("cases", ["cases/cases.yaml"])
+@pytest.mark.parametrize("max_stem_allow_smaller", [0, 1])
+def test_stem_bound(parser, library_path: str, cases: str, max_stem_allow_smaller: int):
+    with open(cases) as fin:
+        sequences = [case["case"] for case in yaml.safe_load(fin)]
+
+    args = {"library_path": library_path, "max_dd_size": 2, "allow_ug": True}
+    pairalign = CPairAlign(CPAIRALIGN)
+
+    skipped = 0
+    for sequence in sequences:
+        expected = parser(**args).detect_pseudoknots(sequence)
+
+        p = parser(stem_bound=max_stem_allow_smaller, **args)
+        result = p.detect_pseudoknots(sequence)
+        stats = p.get_stem_bound_stats()
+
+        # the bound only drops core stems, the rest are reported in the same order
+        it = iter(expected)
+        assert all(core_stem in it for core_stem in result)
+
+        # core stems that prune_early discards, given their consecutive loop stems
+        rows = pairalign.pairalign_candidates(sequence, expected)
+        size = np.zeros(len(expected), dtype=int)
+        size[rows[:, CANDIDATE["core_stem"]]] = (
+            rows[:, CANDIDATE["left_loop_stems"]]
+            + rows[:, CANDIDATE["right_loop_stems"]]
+        )
+        max_size = np.maximum.accumulate(np.concatenate(([0], size[:-1])))
+        discarded = {
+            core_stem
+            for core_stem, small in zip(
+                expected, size < max_size - max_stem_allow_smaller
+            )
+            if small
+        }
+
+        assert set(expected) - set(result) <= discarded
+        assert stats["core_stems_skipped"] <= stats["core_stems"]
+        assert stats["windows_skipped"] <= stats["windows"]
+        skipped += stats["core_stems_skipped"] + stats["windows_skipped"]
+
+    assert skipped > 0
@@ -21,28 +21,44 @@
 # SOFTWARE.
 #
 import os
+import subprocess
+import sys
 
+import numpy as np
+import pandas as pd
 import pytest
 
+from knotify.criteria import apply_free_energy_and_stems_criterion
 from knotify.energy.pkenergy import PKEnergy
 
 PKENERGY_SO = os.getenv("PKENERGY_SO", "./libpkenergy.so")
 PKENERGY_PARAMS = os.getenv("PKENERGY_PARAMS", "pkenergy/hotknots/params")
 PKENERGY_MODEL = os.getenv("PKENERGY_MODEL", "dp")
 
+# sequence and candidate dot brackets shared by the test cases below
+SEQUENCE = "AAUGCAACUUUUAAAUAGUUUAUCUGUUAAGAUAAACCACCUAGGUUGCAUAUAUAAAAAAUAAAAGGUGCC"
+DOT_BRACKETS = [
+    ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+    ".((((((((.............................[[[[))))))))...............]]]]...",
+    "........................................................................",
+    ".(((((((((...........................)))))))))..........................",
+    "..((((.....[[[[[...))))....(((((...]]]]]...)))))........................",
+    ".((.((((((...........................[[[[[))))))..))..............]]]]]..",
+]
+
 
 @pytest.mark.parametrize(
     "sequence, dot_bracket, model, result",
     [
         (
-            "AAUGCAACUUUUAAAUAGUUUAUCUGUUAAGAUAAACCACCUAGGUUGCAUAUAUAAAAAAUAAAAGGUGCC",
-            ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+            SEQUENCE,
+            DOT_BRACKETS[0],
             "dp",
             -6.985999584197998,
         ),
         (
-            "AAUGCAACUUUUAAAUAGUUUAUCUGUUAAGAUAAACCACCUAGGUUGCAUAUAUAAAAAAUAAAAGGUGCC",
-            ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+            SEQUENCE,
+            DOT_BRACKETS[0],
             "cc2006b",
             -11.74093246459961,
         ),
@@ -51,3 +67,207 @@ PKENERGY_MODEL = os.getenv("PKENERGY_MODEL", "dp")
 def test_pkenergy(sequence: str, dot_bracket: str, model: str, result: float):
     e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model)
     assert e.eval(sequence, dot_bracket) == result
+
+
+@pytest.mark.parametrize("threads", [1, 3, 0])
+@pytest.mark.parametrize("model", ["dp", "cc2006b"])
+@pytest.mark.parametrize(
+    "sequence, dot_brackets",
+    [
+        (
+            SEQUENCE,
+            DOT_BRACKETS[:4],
+        ),
+        (SEQUENCE.lower(), DOT_BRACKETS[:1]),
+        ("AAUGCAACUUUUAAAUAGUUUAUCUGUUAAGAUAAACC", []),
+    ],
+)
+def test_pkenergy_eval_many(
+    sequence: str, dot_brackets: list, model: str, threads: int
+):
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model, threads=threads)
+    expected = [e.eval(sequence, dot_bracket) for dot_bracket in dot_brackets]
+    assert list(e.eval_many(sequence, dot_brackets)) == expected
+
+
+@pytest.mark.parametrize("model", ["dp", "cc2006b"])
+@pytest.mark.parametrize(
+    "base, removed, added, edited",
+    [
+        (
+            ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+            [(1, 50)],
+            [],
+            "..((((((((...........................[[[[[))))))))...............]]]]]..",
+        ),
+        (
+            ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+            [(37, 69), (41, 65)],
+            [],
+            ".(((((((((............................[[[.)))))))))...............]]]...",
+        ),
+        (
+            "..((((((((...........................[[[[[))))))))...............]]]]]..",
+            [],
+            [(1, 50)],
+            ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+        ),
+        (
+            ".(((((((((...........................[[[[[)))))))))..............]]]]]..",
+            [],
+            [(20, 28)],
+            ".(((((((((..........(.......)........[[[[[)))))))))..............]]]]]..",
+        ),
+        (
+            ".(((((((((...........................)))))))))..........................",
+            [(9, 37)],
+            [(55, 65)],
+            ".((((((((.............................)))))))).........(.........)......",
+        ),
+    ],
+)
+def test_pkenergy_eval_edit(
+    base: str, removed: list, added: list, edited: str, model: str
+):
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model)
+    assert e.set_base(SEQUENCE, base) == e.eval(SEQUENCE, base)
+    assert e.eval_edit(removed, added) == e.eval(SEQUENCE, edited)
+
+
+@pytest.mark.parametrize("cache_size", [1, 1000])
+@pytest.mark.parametrize("model", ["dp", "cc2006b"])
+def test_pkenergy_cache(model: str, cache_size: int):
+    dot_brackets = [DOT_BRACKETS[i] for i in (0, 1, 3, 4)] * 2
+
+    expected = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model).eval_many(
+        SEQUENCE, dot_brackets
+    )
+
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model, cache_size=cache_size)
+    assert list(e.eval_many(SEQUENCE, dot_brackets)) == list(expected)
+
+    hits, misses = e.cache_stats()
+    assert misses > 0
+    if cache_size > 1:
+        assert hits > 0
+
+
+def test_pkenergy_cache_per_model():
+    dot_brackets = DOT_BRACKETS * 2
+
+    # the cache size is kept for each model
+    PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp", cache_size=1000)
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp")
+    e.eval_many(SEQUENCE, dot_brackets)
+    assert e.cache_stats()[0] > 0
+
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "cc2006b", cache_size=0)
+    e.eval_many(SEQUENCE, dot_brackets)
+    assert e.cache_stats() == (0, 0)
+
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp")
+    e.eval_many(SEQUENCE, dot_brackets)
+    assert e.cache_stats()[0] > 0
+
+    # disable the cache again for later tests
+    PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp", cache_size=0)
+
+
+@pytest.mark.parametrize(
+    "models",
+    [
+        ["dp"],
+        ["re", "dp", "cc2006a", "cc2006b", "cc2006c"],
+        ["cc2006c", "dp", "dp", "cc2006b", "re", "cc2006a"],
+    ],
+)
+@pytest.mark.parametrize("dot_bracket", [DOT_BRACKETS[i] for i in (0, 3, 4, 2)])
+def test_pkenergy_eval_models(dot_bracket: str, models: list):
+    expected = [
+        PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model).eval(SEQUENCE, dot_bracket)
+        for model in models
+    ]
+
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp")
+    assert list(e.eval_models(SEQUENCE, dot_bracket, models)) == expected
+
+
+@pytest.mark.parametrize("model", ["dp", "cc2006b"])
+def test_pkenergy_bound_many(model: str):
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model)
+    bounds = e.bound_many(SEQUENCE, DOT_BRACKETS)
+    energies = e.eval_many(SEQUENCE, DOT_BRACKETS)
+    if model == "dp":
+        assert all(bounds <= energies + 1e-3)
+        assert all(bounds > -np.inf)
+    else:
+        assert all(bounds == -np.inf)
+
+
+@pytest.mark.parametrize("top_k", [1, 2, 5])
+@pytest.mark.parametrize("model", ["dp", "cc2006b"])
+def test_criterion_top_k(model: str, top_k: int):
+    data = pd.DataFrame(
+        {
+            "dot_bracket": DOT_BRACKETS * 2,
+            "left_loop_stems": 1,
+            "right_loop_stems": 1,
+            "dd": 0,
+        }
+    )
+
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model)
+    full = apply_free_energy_and_stems_criterion(data.copy(), SEQUENCE, 0, e)
+    result = apply_free_energy_and_stems_criterion(
+        data.copy(), SEQUENCE, 0, e, top_k=top_k
+    )
+
+    columns = ["dot_bracket", "energy"]
+    assert result[columns][:top_k].equals(full[columns][:top_k])
+    assert result.attrs["energy_evaluations"] + result.attrs[
+        "energy_evaluations_skipped"
+    ] == len(DOT_BRACKETS)
+    if model == "dp" and top_k == 1:
+        assert result.attrs["energy_evaluations_skipped"] > 0
+    if model == "cc2006b":
+        assert result.attrs["energy_evaluations_skipped"] == 0
+
+
+@pytest.mark.parametrize("model", ["dp", "cc2006b"])
+def test_pkenergy_snapshot(model: str, tmp_path):
+    dot_bracket = DOT_BRACKETS[0]
+    snapshot = str(tmp_path / "params.bin")
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model)
+    e.export_parameters(snapshot)
+    expected = e.eval(SEQUENCE, dot_bracket)
+
+    # the parameter files are not read in a new process
+    script = "\n".join(
+        [
+            "from knotify.energy.pkenergy import PKEnergy",
+            "e = PKEnergy({!r}, '/nonexistent', {!r}, snapshot={!r})",
+            "print(repr(e.eval({!r}, {!r})))",
+        ]
+    ).format(PKENERGY_SO, model, snapshot, SEQUENCE, dot_bracket)
+    result = subprocess.run(
+        [sys.executable, "-c", script], capture_output=True, check=True, text=True
+    )
+    assert float(result.stdout) == expected
+
+    # loading the snapshot restores the same parameters
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, model, snapshot=snapshot)
+    e.export_parameters(snapshot + ".2")
+    with open(snapshot, "rb") as f1, open(snapshot + ".2", "rb") as f2:
+        assert f1.read() == f2.read()
+
+
+def test_pkenergy_snapshot_invalid(tmp_path):
+    dot_bracket = DOT_BRACKETS[0]
+    expected = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp").eval(SEQUENCE, dot_bracket)
+
+    snapshot = tmp_path / "params.bin"
+    snapshot.write_bytes(b"not a snapshot")
+
+    # the parameter files are used instead
+    e = PKEnergy(PKENERGY_SO, PKENERGY_PARAMS, "dp", snapshot=str(snapshot))
+    assert e.eval(SEQUENCE, dot_bracket) == expected
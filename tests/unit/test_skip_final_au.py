@@ -21,8 +21,12 @@
 # SOFTWARE.
 #
 import pytest
+import yaml
 
 from knotify.extensions.skip_final_au import SkipFinalAU
+from knotify.pairalign.base import CANDIDATE
+from knotify.parsers.span import SpanParser
+from tests.utils import SPAN, for_each_pairalign
 
 SKIPFINALAU_SO = "./libskipfinalau.so"
 
@@ -51,3 +55,37 @@ def test_skip_final_au(sequence: str, input: str, expected: list):
     a = SkipFinalAU(SKIPFINALAU_SO)
 
     assert set(a.get_candidates(sequence.lower(), *input)) == set(expected)
+
+
+@for_each_pairalign(min_stems_after_bulge=1)
+@pytest.mark.parametrize("cases", ["cases/bulges.yaml"])
+def test_pairalign_skip_final_au(pairalign, cases):
+    with open(cases) as fin:
+        sequences = [case["case"].lower() for case in yaml.safe_load(fin)]
+
+    a = SkipFinalAU(SKIPFINALAU_SO)
+    for sequence in sequences:
+        core_stems = SpanParser(SPAN, max_dd_size=2).detect_pseudoknots_packed(sequence)
+        candidates = pairalign.pairalign_candidates(sequence, core_stems)
+
+        expected = []
+        for (dot_bracket, candidate) in zip(
+            pairalign.render_candidates(sequence, candidates).astype(str),
+            candidates.tolist(),
+        ):
+            left = candidate[CANDIDATE["left_loop_stems"]]
+            right = candidate[CANDIDATE["right_loop_stems"]]
+            expected.append((dot_bracket, left, right))
+            expected.extend(a.get_candidates(sequence, dot_bracket, left, right))
+
+        candidates = pairalign.pairalign_candidates(
+            sequence, core_stems, skip_final_au=True
+        )
+        assert [
+            (dot_bracket, left, right)
+            for (dot_bracket, left, right) in zip(
+                pairalign.render_candidates(sequence, candidates).astype(str),
+                candidates[:, CANDIDATE["left_loop_stems"]].tolist(),
+                candidates[:, CANDIDATE["right_loop_stems"]].tolist(),
+            )
+        ] == expected
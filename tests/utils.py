@@ -25,10 +25,22 @@ import os
 import pytest
 
 from knotify.parsers.bruteforce import BruteForceParser
+from knotify.parsers.span import SpanParser
 from knotify.parsers.yaep import YaepParser
 
 PSEUDOKNOT = os.getenv("PSEUDOKNOT_SO", "./libpseudoknot.so")
 BRUTEFORCE = os.getenv("BRUTEFORCE_SO", "./libbruteforce.so")
+SPAN = os.getenv("SPAN_SO", "./libspan.so")
+CPAIRALIGN = os.getenv("CPAIRALIGN_SO", "./libcpairalign.so")
+BULGES = os.getenv("BULGES_SO", "./libbulges.so")
+
+# configuration of the bulges pairalign in for_each_pairalign()
+BULGES_CONFIG = {
+    "max_bulge_size": 3,
+    "min_stems_after_bulge": 2,
+    "symmetric_bulges": False,
+    "count_stems_from_bulges": True,
+}
 
 
 def for_each_parser(variable_names):
@@ -38,7 +50,20 @@ def for_each_parser(variable_names):
             [
                 (YaepParser, PSEUDOKNOT),
                 (BruteForceParser, BRUTEFORCE),
+                (SpanParser, SPAN),
             ],
         )(f)
 
     return wrapped
+
+
+def for_each_pairalign(**overrides):
+    """
+    Parametrize the pairalign fixture (see tests/conftest.py) with the consecutive
+    pairalign, and the bulges pairalign with BULGES_CONFIG updated with overrides.
+    """
+    return pytest.mark.parametrize(
+        "pairalign",
+        [("consecutive", {}), ("bulges", {**BULGES_CONFIG, **overrides})],
+        indirect=True,
+    )